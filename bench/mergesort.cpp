@@ -0,0 +1,84 @@
+
+#include <chrono>
+#include <iostream>
+
+#include "cmdline.hpp"
+#include "spsort.hpp"
+#include "sprandgen.hpp"
+
+namespace sptl {
+
+  // the mergesort as it was before ping-pong buffering: after each merge,
+  // the merged range is copied back from the temporary to the source array
+  template <class Merge_fct>
+  class copyback_merge_output {
+  public:
+
+    using result_type = std::pair<size_type, size_type>;
+
+    Merge_fct merge_fct;
+
+    copyback_merge_output(const Merge_fct& merge_fct)
+    : merge_fct(merge_fct) { }
+
+    void init(result_type& rng) const {
+      rng = std::make_pair(0, 0);
+    }
+
+    void merge(const result_type& src, result_type& dst) const {
+      merge_fct(dst.first, dst.second, src.second);
+      dst.second = src.second;
+    }
+
+  };
+
+  template <class Item, class Compare>
+  void mergesort_copyback(Item* xs, size_type n, const Compare& compare) {
+    using input_type = level4::tabulate_input;
+    using result_type = std::pair<size_type, size_type>;
+    parray<Item> tmp(n);
+    auto merge_fct = [&] (size_type lo, size_type mid, size_type hi) {
+      merge(xs + lo, xs + mid, xs + mid, xs + hi, tmp.begin() + lo, compare);
+      sptl::copy(tmp.cbegin() + lo, tmp.cbegin() + hi, xs + lo);
+    };
+    using output_type = copyback_merge_output<decltype(merge_fct)>;
+    input_type in(0, n);
+    output_type out(merge_fct);
+    result_type id(0, 0);
+    result_type dst = id;
+    auto convert_reduce = [&] (input_type& in, result_type& dst) {
+      std::sort(xs + in.lo, xs + in.hi, compare);
+      dst = std::make_pair(in.lo, in.hi);
+    };
+    level4::reduce(in, out, id, dst, convert_reduce, convert_reduce);
+  }
+
+  void bench(size_type n, std::string algo) {
+    parray<double> xs(n, [] (size_type i) {
+      return hashd((int)i);
+    });
+    auto compare = std::less<double>();
+    auto start = std::chrono::system_clock::now();
+    if (algo == "pingpong") {
+      mergesort(xs.begin(), xs.end(), compare);
+    } else if (algo == "copyback") {
+      mergesort_copyback(xs.begin(), n, compare);
+    } else {
+      die("unknown algorithm %s", algo.c_str());
+    }
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<float> diff = end - start;
+    printf ("exectime %.3lf\n", diff.count());
+    printf ("result %d\n", (int)std::is_sorted(xs.cbegin(), xs.cend(), compare));
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  sptl::launch(argc, argv, [&] {
+    sptl::size_type n = deepsea::cmdline::parse_or_default_long("n", 100000000);
+    std::string algo = deepsea::cmdline::parse_or_default_string("algo", "pingpong");
+    sptl::bench(n, algo);
+  });
+  return 0;
+}
@@ -0,0 +1,74 @@
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "cmdline.hpp"
+#include "sppset.hpp"
+#include "sppersistentset.hpp"
+#include "sprandgen.hpp"
+
+// Measures set union, intersection and difference of a set of n keys
+// with a set of m keys, for m ranging over several orders of magnitude
+// below n. Half of the m keys are taken from the n keys, spread evenly
+// across them, and the other half are fresh, so that the intersection
+// and the difference are both nonempty.
+
+namespace sptl {
+
+  template <class Set>
+  double run(Set& xs, Set& ys, std::string op) {
+    auto start = std::chrono::system_clock::now();
+    if (op == "union") {
+      xs.merge(ys);
+    } else if (op == "intersect") {
+      xs.intersect(ys);
+    } else if (op == "diff") {
+      xs.diff(ys);
+    } else {
+      die("unknown operation %s", op.c_str());
+    }
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<float> diff = end - start;
+    return diff.count();
+  }
+
+  void bench(size_type n, size_type m, std::string algo, std::string op) {
+    parray<int> keys_n(n, [&] (size_type i) {
+      return hashi((int)i);
+    });
+    size_type step = std::max((size_type)1, n / std::max((size_type)1, m));
+    parray<int> keys_m(m, [&] (size_type i) {
+      return (i % 2 == 0) ? hashi((int)(i * step)) : hashi((int)(n + i));
+    });
+    double exectime;
+    size_type result;
+    if (algo == "pset") {
+      pset<int> xs(keys_n.cbegin(), keys_n.cend());
+      pset<int> ys(keys_m.cbegin(), keys_m.cend());
+      exectime = run(xs, ys, op);
+      result = xs.size();
+    } else if (algo == "persistent") {
+      persistent_pset<int> xs(keys_n.cbegin(), keys_n.cend());
+      persistent_pset<int> ys(keys_m.cbegin(), keys_m.cend());
+      exectime = run(xs, ys, op);
+      result = xs.size();
+    } else {
+      die("unknown algorithm %s", algo.c_str());
+    }
+    printf ("exectime %.3lf\n", exectime);
+    printf ("result %ld\n", (long)result);
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  sptl::launch(argc, argv, [&] {
+    sptl::size_type n = deepsea::cmdline::parse_or_default_long("n", 10000000);
+    sptl::size_type m = deepsea::cmdline::parse_or_default_long("m", 1000);
+    std::string algo = deepsea::cmdline::parse_or_default_string("algo", "pset");
+    std::string op = deepsea::cmdline::parse_or_default_string("op", "union");
+    sptl::bench(n, m, algo, op);
+  });
+  return 0;
+}
@@ -0,0 +1,84 @@
+
+#include <chrono>
+#include <iostream>
+
+#include "cmdline.hpp"
+#include "sppstring.hpp"
+#include "sprandgen.hpp"
+
+// Counts the words and the lines of a text of n characters, made of
+// words of random lengths separated by spaces and newlines, either by
+// a sequential tokenizing loop or by the parallel split and count_if
+// of pstring.
+
+namespace sptl {
+
+  pstring gen_text(size_type n) {
+    return pstring(n, [&] (size_type i) {
+      unsigned int h = hashu((unsigned int)i);
+      if (h % 53 == 0) {
+        return '\n';
+      } else if (h % 6 == 0) {
+        return ' ';
+      } else {
+        return (char)('a' + h % 26);
+      }
+    });
+  }
+
+  std::pair<size_type, size_type> wordcount_seq(const pstring& text) {
+    const char* s = text.c_str();
+    size_type n = text.size();
+    size_type nb_words = 0;
+    size_type nb_lines = 0;
+    bool in_word = false;
+    for (size_type i = 0; i < n; i++) {
+      char c = s[i];
+      if (c == '\n') {
+        nb_lines++;
+      }
+      bool is_delim = (c == ' ') || (c == '\n');
+      if (! is_delim && ! in_word) {
+        nb_words++;
+      }
+      in_word = ! is_delim;
+    }
+    return std::make_pair(nb_words, nb_lines);
+  }
+
+  std::pair<size_type, size_type> wordcount_par(const pstring& text) {
+    size_type nb_words = text.split(" \n").size();
+    size_type nb_lines = text.count_if([&] (char c) {
+      return c == '\n';
+    });
+    return std::make_pair(nb_words, nb_lines);
+  }
+
+  void bench(size_type n, std::string algo) {
+    pstring text = gen_text(n);
+    std::pair<size_type, size_type> result;
+    auto start = std::chrono::system_clock::now();
+    if (algo == "sequential") {
+      result = wordcount_seq(text);
+    } else if (algo == "parallel") {
+      result = wordcount_par(text);
+    } else {
+      die("unknown algorithm %s", algo.c_str());
+    }
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<float> diff = end - start;
+    printf ("exectime %.3lf\n", diff.count());
+    printf ("words %ld\n", (long)result.first);
+    printf ("lines %ld\n", (long)result.second);
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  sptl::launch(argc, argv, [&] {
+    sptl::size_type n = deepsea::cmdline::parse_or_default_long("n", 100000000);
+    std::string algo = deepsea::cmdline::parse_or_default_string("algo", "parallel");
+    sptl::bench(n, algo);
+  });
+  return 0;
+}
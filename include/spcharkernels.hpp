@@ -0,0 +1,262 @@
+
+#include <string.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SPTL_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#include "spmachine.hpp"
+
+#ifndef _SPTL_CHARKERNELS_H_
+#define _SPTL_CHARKERNELS_H_
+
+namespace sptl {
+namespace simd {
+
+/*---------------------------------------------------------------------*/
+/* Sequential kernels over ranges of characters */
+
+/* These are the loops run by the sequential leaves of the parallel
+ * string operations. Each kernel has a scalar version and, on x86-64,
+ * vectorized versions; the fastest version that the machine supports
+ * is chosen at run time.
+ *
+ *   - find_char(lo, hi, c) returns a pointer to the first c in [lo, hi)
+ *   - find_any_of(lo, hi, set, nset) returns a pointer to the first
+ *     character in [lo, hi) that belongs to set[0..nset)
+ *   - count_char(lo, hi, c) returns the number of c in [lo, hi)
+ *   - mark_any_of(lo, hi, set, nset, dst) writes to dst[i] whether
+ *     lo[i] belongs to set[0..nset)
+ *
+ * The find kernels return hi when there is no match.
+ */
+
+namespace scalar {
+
+static inline
+const char* find_char(const char* lo, const char* hi, char c) {
+  for (const char* p = lo; p != hi; p++) {
+    if (*p == c) {
+      return p;
+    }
+  }
+  return hi;
+}
+
+static inline
+size_type count_char(const char* lo, const char* hi, char c) {
+  size_type r = 0;
+  for (const char* p = lo; p != hi; p++) {
+    r += (*p == c);
+  }
+  return r;
+}
+
+static inline
+void make_table(const char* set, int nset, bool* table) {
+  memset(table, 0, 256);
+  for (int k = 0; k < nset; k++) {
+    table[(unsigned char)set[k]] = true;
+  }
+}
+
+static inline
+const char* find_any_of(const char* lo, const char* hi, const char* set, int nset) {
+  bool table[256];
+  make_table(set, nset, table);
+  for (const char* p = lo; p != hi; p++) {
+    if (table[(unsigned char)*p]) {
+      return p;
+    }
+  }
+  return hi;
+}
+
+static inline
+void mark_any_of(const char* lo, const char* hi, const char* set, int nset, bool* dst) {
+  bool table[256];
+  make_table(set, nset, table);
+  for (const char* p = lo; p != hi; p++) {
+    *dst++ = table[(unsigned char)*p];
+  }
+}
+
+} // end namespace
+
+#ifdef SPTL_HAVE_X86_KERNELS
+
+namespace avx2 {
+
+// beyond this many characters in the set, the scalar table lookup wins
+static constexpr
+int max_set_size = 8;
+
+__attribute__((target("avx2")))
+static inline
+__m256i any_of_mask(__m256i x, const __m256i* set, int nset) {
+  __m256i acc = _mm256_setzero_si256();
+  for (int k = 0; k < nset; k++) {
+    acc = _mm256_or_si256(acc, _mm256_cmpeq_epi8(x, set[k]));
+  }
+  return acc;
+}
+
+__attribute__((target("avx2")))
+static inline
+const char* find_char(const char* lo, const char* hi, char c) {
+  __m256i vc = _mm256_set1_epi8(c);
+  const char* p = lo;
+  for (; hi - p >= 32; p += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+    unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, vc));
+    if (m != 0) {
+      return p + __builtin_ctz(m);
+    }
+  }
+  return scalar::find_char(p, hi, c);
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline
+size_type count_char(const char* lo, const char* hi, char c) {
+  __m256i vc = _mm256_set1_epi8(c);
+  size_type r = 0;
+  const char* p = lo;
+  for (; hi - p >= 32; p += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+    r += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, vc)));
+  }
+  return r + scalar::count_char(p, hi, c);
+}
+
+__attribute__((target("avx2")))
+static inline
+const char* find_any_of(const char* lo, const char* hi, const char* set, int nset) {
+  __m256i vset[max_set_size];
+  for (int k = 0; k < nset; k++) {
+    vset[k] = _mm256_set1_epi8(set[k]);
+  }
+  const char* p = lo;
+  for (; hi - p >= 32; p += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+    unsigned m = _mm256_movemask_epi8(any_of_mask(x, vset, nset));
+    if (m != 0) {
+      return p + __builtin_ctz(m);
+    }
+  }
+  return scalar::find_any_of(p, hi, set, nset);
+}
+
+__attribute__((target("avx2")))
+static inline
+void mark_any_of(const char* lo, const char* hi, const char* set, int nset, bool* dst) {
+  __m256i vset[max_set_size];
+  for (int k = 0; k < nset; k++) {
+    vset[k] = _mm256_set1_epi8(set[k]);
+  }
+  __m256i one = _mm256_set1_epi8(1);
+  const char* p = lo;
+  for (; hi - p >= 32; p += 32, dst += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+    __m256i m = _mm256_and_si256(any_of_mask(x, vset, nset), one);
+    _mm256_storeu_si256((__m256i*)dst, m);
+  }
+  scalar::mark_any_of(p, hi, set, nset, dst);
+}
+
+} // end namespace
+
+namespace sse42 {
+
+static constexpr
+int max_set_size = 16;
+
+__attribute__((target("sse4.2")))
+static inline
+const char* find_any_of(const char* lo, const char* hi, const char* set, int nset) {
+  char buf[16] = { 0 };
+  memcpy(buf, set, nset);
+  __m128i vset = _mm_loadu_si128((const __m128i*)buf);
+  const char* p = lo;
+  for (; hi - p >= 16; p += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)p);
+    int i = _mm_cmpestri(vset, nset, x, 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+    if (i < 16) {
+      return p + i;
+    }
+  }
+  return scalar::find_any_of(p, hi, set, nset);
+}
+
+} // end namespace
+
+namespace {
+
+static inline
+bool cpu_has_avx2() {
+  static bool b = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+  return b;
+}
+
+static inline
+bool cpu_has_sse42() {
+  static bool b = __builtin_cpu_supports("sse4.2");
+  return b;
+}
+
+} // end namespace
+
+#endif
+
+/*---------------------------------------------------------------------*/
+/* Dispatch */
+
+static inline
+const char* find_char(const char* lo, const char* hi, char c) {
+#ifdef SPTL_HAVE_X86_KERNELS
+  if (cpu_has_avx2()) {
+    return avx2::find_char(lo, hi, c);
+  }
+#endif
+  return scalar::find_char(lo, hi, c);
+}
+
+static inline
+size_type count_char(const char* lo, const char* hi, char c) {
+#ifdef SPTL_HAVE_X86_KERNELS
+  if (cpu_has_avx2()) {
+    return avx2::count_char(lo, hi, c);
+  }
+#endif
+  return scalar::count_char(lo, hi, c);
+}
+
+static inline
+const char* find_any_of(const char* lo, const char* hi, const char* set, int nset) {
+#ifdef SPTL_HAVE_X86_KERNELS
+  if (nset <= avx2::max_set_size && cpu_has_avx2()) {
+    return avx2::find_any_of(lo, hi, set, nset);
+  }
+  if (nset <= sse42::max_set_size && cpu_has_sse42()) {
+    return sse42::find_any_of(lo, hi, set, nset);
+  }
+#endif
+  return scalar::find_any_of(lo, hi, set, nset);
+}
+
+static inline
+void mark_any_of(const char* lo, const char* hi, const char* set, int nset, bool* dst) {
+#ifdef SPTL_HAVE_X86_KERNELS
+  if (nset <= avx2::max_set_size && cpu_has_avx2()) {
+    avx2::mark_any_of(lo, hi, set, nset, dst);
+    return;
+  }
+#endif
+  scalar::mark_any_of(lo, hi, set, nset, dst);
+}
+
+} // end namespace
+} // end namespace
+
+#endif
@@ -0,0 +1,306 @@
+
+#include <string>
+#include <vector>
+
+#include "spio.hpp"
+#include "spparse.hpp"
+
+#ifndef _SPTL_CSV_H_
+#define _SPTL_CSV_H_
+
+namespace sptl {
+
+/*---------------------------------------------------------------------*/
+/* Delimiter-separated tables */
+
+/* A table of delimiter-separated values, such as CSV or TSV, whose rows
+ * end with newlines and whose fields are separated by a delimiter
+ * character. A field may be enclosed in double quotes, in which case it
+ * may contain delimiters, newlines and doubled double quotes, which
+ * stand for one double quote.
+ *
+ * The table is indexed on construction: the row boundaries are found
+ * by a parallel scan over the parity of the number of quotes, and the
+ * fields of all the rows are then located in parallel. The columns are
+ * converted to typed arrays on request.
+ */
+class csv_table {
+public:
+
+  using size_type = sptl::size_type;
+  using token_type = pstring::token_type;
+
+private:
+
+  static constexpr
+  size_type block_size = 1 << 14;
+
+  static constexpr
+  char quote = '"';
+
+  pstring text;
+
+  char delim;
+
+  size_type nb_cols = 0;
+
+  size_type nb_rows_ = 0;
+
+  // the field in column j of row i is fields[i * nb_cols + j]
+  parray<token_type> fields;
+
+  std::vector<std::string> names;
+
+  parray<size_type> malformed;
+
+  // returns the positions of the newlines that are not between quotes
+  parray<size_type> row_ends() const {
+    size_type n = text.size();
+    const char* s = text.c_str();
+    size_type nb_blocks = (n + block_size - 1) / block_size;
+    parray<size_type> parities(nb_blocks, [&] (size_type b) {
+      size_type lo = b * block_size;
+      size_type hi = std::min(n, lo + block_size);
+      return simd::count_char(s + lo, s + hi, quote);
+    });
+    dps::scan(parities.begin(), parities.end(), (size_type)0, [&] (size_type x, size_type y) {
+      return x + y;
+    }, parities.begin(), forward_exclusive_scan);
+    parray<bool> is_end;
+    is_end.reset(n);
+    parallel_for((size_type)0, nb_blocks, [&] (size_type b) {
+      size_type lo = b * block_size;
+      size_type hi = std::min(n, lo + block_size);
+      bool in_quotes = parities[b] % 2 == 1;
+      for (size_type i = lo; i < hi; i++) {
+        char c = s[i];
+        in_quotes = in_quotes != (c == quote);
+        is_end[i] = (c == '\n') && ! in_quotes;
+      }
+    });
+    return pack_index(is_end.cbegin(), is_end.cend());
+  }
+
+  // calls visit(k, lo, hi) on the k-th field of the row [lo, hi), for
+  // each field, and returns the number of fields
+  template <class Visit>
+  size_type for_each_field(size_type lo, size_type hi, const Visit& visit) const {
+    const char* s = text.c_str();
+    if (hi > lo && s[hi - 1] == '\r') {
+      hi--;
+    }
+    size_type k = 0;
+    size_type start = lo;
+    bool in_quotes = false;
+    for (size_type i = lo; i < hi; i++) {
+      char c = s[i];
+      if (c == quote) {
+        in_quotes = ! in_quotes;
+      } else if (c == delim && ! in_quotes) {
+        visit(k++, start, i);
+        start = i + 1;
+      }
+    }
+    visit(k++, start, hi);
+    return k;
+  }
+
+  // writes the characters of a field, without the enclosing quotes and
+  // with doubled quotes made single, to dst, unless dst is null, and
+  // returns their number
+  size_type unquote(token_type field, char* dst) const {
+    const char* lo = text.c_str() + field.first;
+    const char* hi = lo + field.second;
+    if (hi - lo < 2 || *lo != quote || *(hi - 1) != quote) {
+      if (dst != nullptr) {
+        std::copy(lo, hi, dst);
+      }
+      return hi - lo;
+    }
+    size_type k = 0;
+    for (const char* p = lo + 1; p < hi - 1; p++) {
+      if (dst != nullptr) {
+        dst[k] = *p;
+      }
+      k++;
+      if (*p == quote && p + 1 < hi - 1 && *(p + 1) == quote) {
+        p++;
+      }
+    }
+    return k;
+  }
+  
+  std::string unquote(token_type field) const {
+    std::string r(unquote(field, nullptr), ' ');
+    unquote(field, &r[0]);
+    return r;
+  }
+
+  // the bounds of a field, without the enclosing quotes, if any
+  std::pair<const char*, const char*> unquoted_bounds(token_type field) const {
+    const char* lo = text.c_str() + field.first;
+    const char* hi = lo + field.second;
+    if (hi - lo >= 2 && *lo == quote && *(hi - 1) == quote) {
+      lo++;
+      hi--;
+    }
+    return std::make_pair(lo, hi);
+  }
+
+  void index(bool has_header) {
+    parray<size_type> ends = row_ends();
+    size_type n = text.size();
+    size_type nb_ends = ends.size();
+    size_type last = (nb_ends == 0) ? 0 : ends[nb_ends - 1] + 1;
+    size_type nb_lines = nb_ends + ((last < n) ? 1 : 0);
+    auto line_lo = [&] (size_type i) {
+      return (i == 0) ? 0 : ends[i - 1] + 1;
+    };
+    auto line_hi = [&] (size_type i) {
+      return (i < nb_ends) ? ends[i] : n;
+    };
+    if (nb_lines == 0) {
+      return;
+    }
+    nb_cols = for_each_field(line_lo(0), line_hi(0), [&] (size_type, size_type, size_type) { });
+    size_type first = 0;
+    if (has_header) {
+      for_each_field(line_lo(0), line_hi(0), [&] (size_type, size_type lo, size_type hi) {
+        names.push_back(unquote(token_type(lo, hi - lo)));
+      });
+      first = 1;
+    }
+    nb_rows_ = nb_lines - first;
+    fields.reset(nb_rows_ * nb_cols);
+    parray<bool> bad;
+    bad.reset(nb_rows_);
+    parallel_for((size_type)0, nb_rows_, [&] (size_type lo, size_type hi) {
+      return (lo == hi) ? 0 : line_hi(first + hi - 1) - line_lo(first + lo) + (hi - lo);
+    }, [&] (size_type i) {
+      token_type* row = &fields[i * nb_cols];
+      size_type lo = line_lo(first + i);
+      size_type k = for_each_field(lo, line_hi(first + i), [&] (size_type k, size_type lo, size_type hi) {
+        if (k < nb_cols) {
+          row[k] = token_type(lo, hi - lo);
+        }
+      });
+      for (size_type j = k; j < nb_cols; j++) {
+        row[j] = token_type(lo, 0);
+      }
+      bad[i] = (k != nb_cols);
+    });
+    malformed = pack_index(bad.cbegin(), bad.cend());
+  }
+
+  template <class Number, class Parse>
+  parray<Number> number_column(size_type j, parray<size_type>& malformed,
+                               const Parse& parse) const {
+    assert(j < nb_cols);
+    parray<bool> bad;
+    bad.reset(nb_rows_);
+    parray<Number> result(nb_rows_, [&] (size_type i) {
+      auto rng = unquoted_bounds(fields[i * nb_cols + j]);
+      Number x = Number();
+      bad[i] = ! parse(rng.first, rng.second, x);
+      return x;
+    });
+    malformed = pack_index(bad.cbegin(), bad.cend());
+    return result;
+  }
+
+public:
+
+  csv_table(pstring text, char delim = ',', bool has_header = true)
+  : delim(delim) {
+    this->text.swap(text);
+    index(has_header);
+  }
+
+  size_type nb_rows() const {
+    return nb_rows_;
+  }
+
+  size_type nb_columns() const {
+    return nb_cols;
+  }
+
+  // the names of the columns, read from the header, if any
+  const std::vector<std::string>& header() const {
+    return names;
+  }
+
+  // the rows, in order, whose number of fields differs from the number
+  // of fields of the first line; the fields that they lack are empty
+  const parray<size_type>& malformed_rows() const {
+    return malformed;
+  }
+
+  // the field in column j of row i, without the enclosing quotes
+  std::string field(size_type i, size_type j) const {
+    assert(i < nb_rows_ && j < nb_cols);
+    return unquote(fields[i * nb_cols + j]);
+  }
+
+  // the fields of column j, read as integers; the rows whose field is
+  // not an integer are written, in order, to malformed, and their
+  // values are zero
+  parray<long> int_column(size_type j, parray<size_type>& malformed) const {
+    return number_column<long>(j, malformed, [&] (const char* lo, const char* hi, long& dst) {
+      return parse_int(lo, hi, dst);
+    });
+  }
+
+  parray<long> int_column(size_type j) const {
+    parray<size_type> malformed;
+    return int_column(j, malformed);
+  }
+
+  parray<double> double_column(size_type j, parray<size_type>& malformed) const {
+    return number_column<double>(j, malformed, [&] (const char* lo, const char* hi, double& dst) {
+      return parse_double(lo, hi, dst);
+    });
+  }
+
+  parray<double> double_column(size_type j) const {
+    parray<size_type> malformed;
+    return double_column(j, malformed);
+  }
+
+  // returns the fields of column j, without their enclosing quotes,
+  // concatenated, and writes to tokens the offset and the length of the
+  // field of each row in the result
+  pstring string_column(size_type j, parray<token_type>& tokens) const {
+    assert(j < nb_cols);
+    parray<size_type> offsets(nb_rows_ + 1, [&] (size_type i) {
+      return (i < nb_rows_) ? unquote(fields[i * nb_cols + j], nullptr) : 0;
+    });
+    size_type total = dps::scan(offsets.begin(), offsets.end(), (size_type)0,
+                                [&] (size_type x, size_type y) {
+                                  return x + y;
+                                }, offsets.begin(), forward_exclusive_scan);
+    pstring result(total);
+    char* dst = result.begin();
+    parallel_for((size_type)0, nb_rows_, [&] (size_type i) {
+      unquote(fields[i * nb_cols + j], dst + offsets[i]);
+    });
+    tokens.tabulate(nb_rows_, [&] (size_type i) {
+      return token_type(offsets[i], offsets[i + 1] - offsets[i]);
+    });
+    return result;
+  }
+
+};
+
+inline
+csv_table read_csv(const std::string& path, bool has_header = true) {
+  return csv_table(read_file(path), ',', has_header);
+}
+
+inline
+csv_table read_tsv(const std::string& path, bool has_header = true) {
+  return csv_table(read_file(path), '\t', has_header);
+}
+
+} // end namespace
+
+#endif
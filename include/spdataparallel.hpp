@@ -1,5 +1,6 @@
 
 #include "spreduce.hpp"
+#include "spcharkernels.hpp"
 
 #ifndef _SPTL_DATAPAR_H_
 #define _SPTL_DATAPAR_H_
@@ -97,34 +98,35 @@ size_type max_index(Iter lo, Iter hi, const Item& id, const Comp& comp) {
 namespace __priv {
 
 // later: can we generalize this algorithm so that we can simultaneously
-// use the int-packing optimization and support non-contiguous layouts
-// of the flags array
-// sums a sequence of n boolean flags
-// an optimized version that sums blocks of 4 booleans by treating
-// them as an integer
-// Only optimized when n is a multiple of 512 and Fl is 4byte aligned
+// use the vectorized count and support non-contiguous layouts of the
+// flags array
+// sums a sequence of n boolean flags, by counting the bytes that are
+// zero with the vectorized character-counting kernel
 size_type sum_flags_serial(const bool *Fl, size_type n) {
-  size_type r = 0;
-  if ((n >= 128) && ((n & 511) == 0) && (((long) Fl & 3) == 0)) {
-    const int* IFl = (const int*) Fl;
-    for (int k = 0; k < (n >> 9); k++) {
-      int rr = 0;
-      for (int j = 0; j < 128; j++) {
-        rr += IFl[j];
-      }
-      r += (rr&255) + ((rr>>8)&255) + ((rr>>16)&255) + ((rr>>24)&255);
-      IFl += 128;
-    }
-  } else {
-    for (size_type j = 0; j < n; j++) {
-      r += Fl[j];
-    }
-  }
-  return r;
+  const char* lo = (const char*) Fl;
+  return n - simd::count_char(lo, lo + n, 0);
 }
 
 static constexpr
 int pack_branching_factor = 2048;
+
+/* Splits the positions [0, n) into blocks of pack_branching_factor
+ * positions, writes to offsets the exclusive prefix sums, by combine,
+ * of the counts count_rng(lo, hi) of the blocks [lo, hi), and returns
+ * the total.
+ */
+template <class Count, class Combine, class Count_rng>
+Count scan_block_counts(size_type n, Count id, const Combine& combine,
+                        const Count_rng& count_rng, parray<Count>& offsets) {
+  size_type nb_branches = (n + pack_branching_factor - 1) / pack_branching_factor;
+  offsets.tabulate(nb_branches, [&] (size_type i) {
+    size_type lo = i * pack_branching_factor;
+    size_type hi = std::min((i + 1) * pack_branching_factor, n);
+    return count_rng(lo, hi);
+  });
+  return dps::scan(offsets.begin(), offsets.end(), id, combine,
+                   offsets.begin(), forward_exclusive_scan);
+}
   
 template <
   class Flags_iter,
@@ -143,29 +145,24 @@ size_type pack(Flags_iter flags_lo, Iter lo, Iter hi, Item&, const Output& out,
     auto dst_lo = out(m);
     for (size_type i = 0, j = 0; i < n; i++) {
       if (flags_lo[i]) {
-        dst_lo[j++] = lo[i];
+        dst_lo[j++] = f(i, lo[i]);
       }
     }
     return m;
   }
   size_type nb_branches = (n + pack_branching_factor - 1) / pack_branching_factor;
-  parray<size_type> sizes(nb_branches, [&] (size_type i) {
-    size_type lo = i * pack_branching_factor;
-    size_type hi = std::min((i + 1) * pack_branching_factor, n);
-    return level2::reduce(flags_lo + lo, flags_lo + hi, (size_type)0,
-                          [&] (size_type x, size_type y) {
-                            return x + y;
-                          },
+  auto plus = [&] (size_type x, size_type y) {
+    return x + y;
+  };
+  parray<size_type> sizes;
+  size_type m = scan_block_counts(n, (size_type)0, plus, [&] (size_type lo, size_type hi) {
+    return level2::reduce(flags_lo + lo, flags_lo + hi, (size_type)0, plus,
                           [&] (size_type, reference_of<Flags_iter> x) {
                             return x ? 1 : 0;
                           }, [&] (Flags_iter lo, Flags_iter hi) {
                             return (size_type)sum_flags_serial(lo, hi - lo);
                           });
-  });
-  size_type m = dps::scan(sizes.begin(), sizes.end(), (size_type)0,
-                       [&] (size_type x, size_type y) {
-                         return x + y;
-                       }, sizes.begin(), forward_exclusive_scan);
+  }, sizes);
   auto dst_lo = out(m);
   auto comp = [&] (size_type lo, size_type hi) {
     return hi - lo;
@@ -182,7 +179,7 @@ size_type pack(Flags_iter flags_lo, Iter lo, Iter hi, Item&, const Output& out,
     }
   }, [&, dst_lo, flags_lo, sizes] (size_type _lo, size_type _hi) {
     size_type blo = _lo * pack_branching_factor;
-    size_type bhi = std::min(n, (_hi + 1) * pack_branching_factor);
+    size_type bhi = std::min(n, _hi * pack_branching_factor);
     size_type offset = sizes[_lo];
     for (auto i = blo; i < bhi; i++) {
       if (flags_lo[i]) {
@@ -308,6 +305,210 @@ namespace dps {
   
 } // end namespace
 
+/*---------------------------------------------------------------------*/
+/* Partition */
+
+namespace dps {
+
+  /* Writes to dst_lo the items of [lo, hi) that satisfy pred, followed
+   * by the ones that do not, both in their relative order, and returns
+   * the number of the former. The items are read by one pass that counts
+   * the items that satisfy pred in each block and one pass that moves
+   * them, at the offsets given by the scan of the counts.
+   */
+  template <
+    class Input_iter,
+    class Output_iter,
+    class Pred
+  >
+  size_type partition(Input_iter lo, Input_iter hi, Output_iter dst_lo, const Pred& pred) {
+    size_type n = hi - lo;
+    size_type block_size = __priv::pack_branching_factor;
+    parray<size_type> offsets;
+    size_type k = __priv::scan_block_counts(n, (size_type)0, [&] (size_type x, size_type y) {
+      return x + y;
+    }, [&] (size_type l, size_type h) {
+      size_type c = 0;
+      for (size_type i = l; i < h; i++) {
+        c += pred(lo[i]) ? 1 : 0;
+      }
+      return c;
+    }, offsets);
+    parallel_for((size_type)0, offsets.size(), [&] (size_type l, size_type h) {
+      return std::min(n, h * block_size) - l * block_size;
+    }, [&] (size_type b) {
+      size_type l = b * block_size;
+      size_type h = std::min(n, l + block_size);
+      size_type t = offsets[b];
+      size_type f = k + l - offsets[b];
+      for (size_type i = l; i < h; i++) {
+        if (pred(lo[i])) {
+          dst_lo[t++] = lo[i];
+        } else {
+          dst_lo[f++] = lo[i];
+        }
+      }
+    });
+    return k;
+  }
+
+  /* Writes to dst_lo the items of [lo, hi) that satisfy less_pivot,
+   * followed by the other ones that satisfy eq_pivot, followed by the
+   * remaining ones, all in their relative order, and returns the
+   * positions where the second and the third groups start.
+   */
+  template <
+    class Input_iter,
+    class Output_iter,
+    class Less_pivot,
+    class Eq_pivot
+  >
+  std::pair<size_type, size_type> partition3(Input_iter lo, Input_iter hi, Output_iter dst_lo,
+                                             const Less_pivot& less_pivot, const Eq_pivot& eq_pivot) {
+    // the numbers of items that satisfy less_pivot and eq_pivot
+    using counts_type = std::pair<size_type, size_type>;
+    size_type n = hi - lo;
+    size_type block_size = __priv::pack_branching_factor;
+    parray<counts_type> offsets;
+    auto plus = [&] (counts_type x, counts_type y) {
+      return counts_type(x.first + y.first, x.second + y.second);
+    };
+    counts_type total = __priv::scan_block_counts(n, counts_type(0, 0), plus, [&] (size_type l, size_type h) {
+      counts_type c(0, 0);
+      for (size_type i = l; i < h; i++) {
+        if (less_pivot(lo[i])) {
+          c.first++;
+        } else if (eq_pivot(lo[i])) {
+          c.second++;
+        }
+      }
+      return c;
+    }, offsets);
+    size_type nb_less = total.first;
+    size_type nb_less_or_eq = total.first + total.second;
+    parallel_for((size_type)0, offsets.size(), [&] (size_type l, size_type h) {
+      return std::min(n, h * block_size) - l * block_size;
+    }, [&] (size_type b) {
+      size_type l = b * block_size;
+      size_type h = std::min(n, l + block_size);
+      size_type x = offsets[b].first;
+      size_type y = nb_less + offsets[b].second;
+      size_type z = nb_less_or_eq + l - offsets[b].first - offsets[b].second;
+      for (size_type i = l; i < h; i++) {
+        if (less_pivot(lo[i])) {
+          dst_lo[x++] = lo[i];
+        } else if (eq_pivot(lo[i])) {
+          dst_lo[y++] = lo[i];
+        } else {
+          dst_lo[z++] = lo[i];
+        }
+      }
+    });
+    return std::make_pair(nb_less, nb_less_or_eq);
+  }
+
+} // end namespace
+
+/* Rearranges the items in [lo, hi) such that the items that satisfy
+ * pred come first, and returns their number. The relative order of the
+ * items is not preserved.
+ *
+ * After one pass that records the outcomes of pred and counts the
+ * items that satisfy it in each block, the position k where the groups
+ * split is known, and the items that are misplaced are the ones that do
+ * not satisfy pred before k and the ones that do after k. Each block
+ * before k swaps its misplaced items with the misplaced items after k
+ * of the same ranks, which it finds by a binary search over the scanned
+ * counts of the blocks.
+ */
+template <class Iter, class Pred>
+size_type partition(Iter lo, Iter hi, const Pred& pred) {
+  size_type n = hi - lo;
+  size_type block_size = __priv::pack_branching_factor;
+  parray<bool> flags(n, [&] (size_type i) {
+    return pred(lo[i]);
+  });
+  const bool* fl = flags.cbegin();
+  parray<size_type> offsets;
+  size_type k = __priv::scan_block_counts(n, (size_type)0, [&] (size_type x, size_type y) {
+    return x + y;
+  }, [&] (size_type l, size_type h) {
+    return __priv::sum_flags_serial(fl + l, h - l);
+  }, offsets);
+  if (k == 0 || k == n) {
+    return k;
+  }
+  size_type nb_blocks = offsets.size();
+  // the number of items before position p that satisfy pred
+  auto nb_true_before = [&] (size_type p) {
+    size_type b = p / block_size;
+    if (b == nb_blocks) {
+      return k;
+    }
+    return offsets[b] + __priv::sum_flags_serial(fl + b * block_size, p - b * block_size);
+  };
+  size_type kb = k / block_size;
+  size_type nb_true_before_k = nb_true_before(k);
+  // the number of misplaced items before the start of the part after k
+  // of block c, for c >= kb
+  auto nb_misplaced_before = [&] (size_type c) {
+    return (c == kb) ? 0 : offsets[c] - nb_true_before_k;
+  };
+  size_type nb_left_blocks = (k + block_size - 1) / block_size;
+  parallel_for((size_type)0, nb_left_blocks, [&] (size_type l, size_type h) {
+    return std::min(k, h * block_size) - l * block_size;
+  }, [&] (size_type b) {
+    size_type l = b * block_size;
+    size_type h = std::min(k, l + block_size);
+    // the rank of the first misplaced item of the block
+    size_type r = l - offsets[b];
+    // the last block after k with at most r misplaced items before it
+    size_type c_lo = kb;
+    size_type c_hi = nb_blocks;
+    while (c_hi - c_lo > 1) {
+      size_type c = (c_lo + c_hi) / 2;
+      if (nb_misplaced_before(c) <= r) {
+        c_lo = c;
+      } else {
+        c_hi = c;
+      }
+    }
+    size_type p = std::max(k, c_lo * block_size);
+    size_type skip = r - nb_misplaced_before(c_lo);
+    auto next_true = [&] {
+      while (! fl[p]) {
+        p++;
+      }
+    };
+    for (; skip > 0; skip--) {
+      next_true();
+      p++;
+    }
+    for (size_type i = l; i < h; i++) {
+      if (! fl[i]) {
+        next_true();
+        std::swap(lo[i], lo[p]);
+        p++;
+      }
+    }
+  });
+  return k;
+}
+
+/* Rearranges the items in [lo, hi) such that the items that satisfy
+ * less_pivot come first, followed by the other ones that satisfy
+ * eq_pivot, followed by the remaining ones, and returns the positions
+ * where the second and the third groups start. The relative order of
+ * the items is not preserved.
+ */
+template <class Iter, class Less_pivot, class Eq_pivot>
+std::pair<size_type, size_type> partition3(Iter lo, Iter hi,
+                                           const Less_pivot& less_pivot, const Eq_pivot& eq_pivot) {
+  size_type nb_less = sptl::partition(lo, hi, less_pivot);
+  size_type nb_eq = sptl::partition(lo + nb_less, hi, eq_pivot);
+  return std::make_pair(nb_less, nb_less + nb_eq);
+}
+
 /*---------------------------------------------------------------------*/
 /* Array-sum and max */
   
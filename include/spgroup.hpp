@@ -0,0 +1,384 @@
+
+#include <stdlib.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "spperworker.hpp"
+#include "spsort.hpp"
+
+#ifndef _SPTL_GROUP_H_
+#define _SPTL_GROUP_H_
+
+namespace sptl {
+
+/*---------------------------------------------------------------------*/
+/* Counting and grouping by integer keys */
+
+namespace __priv {
+
+// beyond this many buckets, a histogram is computed by sorting the keys
+// instead of by one table of counts per worker
+static constexpr
+size_type histogram_max_local_nb_buckets = 1 << 16;
+
+static constexpr
+size_type histogram_block_size = 1 << 12;
+
+template <class Iter, class Key_fn>
+using key_type_of = typename std::decay<typename std::result_of<Key_fn(value_type_of<Iter>)>::type>::type;
+
+static inline
+int nb_bits_of(size_type nb_buckets) {
+  int bits = 0;
+  while (((size_type)1 << bits) < nb_buckets) {
+    bits++;
+  }
+  return bits;
+}
+
+/* Each worker counts the keys of the blocks that it runs in its own
+ * table, allocated on its first block, and the tables of the workers
+ * that ran at least one block are then summed, bucket by bucket.
+ */
+template <class Iter, class Key_fn>
+parray<size_type> local_histogram(Iter lo, size_type n, size_type nb_buckets,
+                                  const Key_fn& key_fn) {
+  perworker::array<size_type*> tables(nullptr);
+  size_type nb_blocks = (n + histogram_block_size - 1) / histogram_block_size;
+  parallel_for((size_type)0, nb_blocks, [&] (size_type lo_b, size_type hi_b) {
+    return std::min(n, hi_b * histogram_block_size) - lo_b * histogram_block_size;
+  }, [&] (size_type b) {
+    size_type*& counts = tables.mine();
+    if (counts == nullptr) {
+      counts = (size_type*)calloc(nb_buckets, sizeof(size_type));
+    }
+    size_type i = b * histogram_block_size;
+    size_type j = std::min(n, i + histogram_block_size);
+    for (; i < j; i++) {
+      counts[key_fn(lo[i])]++;
+    }
+  });
+  std::vector<size_type*> used;
+  tables.iterate([&] (size_type* counts) {
+    if (counts != nullptr) {
+      used.push_back(counts);
+    }
+  });
+  parray<size_type> result(nb_buckets, [&] (size_type k) {
+    size_type r = 0;
+    for (size_type* counts : used) {
+      r += counts[k];
+    }
+    return r;
+  });
+  for (size_type* counts : used) {
+    free(counts);
+  }
+  return result;
+}
+
+/* Given n keys in nondecreasing order, where key_at(i) is the i-th one
+ * and is in [0, nb_buckets), returns the nb_buckets + 1 offsets such
+ * that the keys equal to k are at the positions [offsets[k],
+ * offsets[k+1]). Position i fills the offsets of the keys in
+ * (key_at(i-1), key_at(i)], so that each offset is written once.
+ */
+template <class Key_at>
+parray<size_type> offsets_of_sorted(size_type n, size_type nb_buckets, const Key_at& key_at) {
+  auto key = [&] (size_type i) {
+    return (i == n) ? nb_buckets : (size_type)key_at(i);
+  };
+  auto first_key = [&] (size_type i) {
+    return (i == 0) ? 0 : key(i - 1) + 1;
+  };
+  parray<size_type> offsets;
+  offsets.reset(nb_buckets + 1);
+  parallel_for((size_type)0, n + 1, [&] (size_type lo, size_type hi) {
+    return (lo == hi) ? 0 : (hi - lo) + key(hi - 1) + 1 - first_key(lo);
+  }, [&] (size_type i) {
+    for (size_type k = first_key(i); k <= key(i); k++) {
+      offsets[k] = i;
+    }
+  });
+  return offsets;
+}
+
+} // end namespace
+
+/* Returns the array of the nb_buckets counts of the items in [lo, hi)
+ * by key, where the key of each item x is key_fn(x), in [0,
+ * nb_buckets). For small numbers of buckets, each worker counts in its
+ * own table and the tables are summed, so that there is no contention;
+ * for larger numbers of buckets, the keys are radix sorted and the
+ * counts are read off the runs of equal keys.
+ */
+template <class Iter, class Key_fn>
+parray<size_type> histogram(Iter lo, Iter hi, size_type nb_buckets, const Key_fn& key_fn) {
+  size_type n = hi - lo;
+  if (nb_buckets <= __priv::histogram_max_local_nb_buckets) {
+    return __priv::local_histogram(lo, n, nb_buckets, key_fn);
+  }
+  parray<size_type> keys(n, [&] (size_type i) {
+    return (size_type)key_fn(lo[i]);
+  });
+  sptl::radix_sort(keys.begin(), keys.end(), [&] (size_type k) {
+    return k;
+  }, __priv::nb_bits_of(nb_buckets));
+  parray<size_type> offsets = __priv::offsets_of_sorted(n, nb_buckets, [&] (size_type i) {
+    return keys[i];
+  });
+  return parray<size_type>(nb_buckets, [&] (size_type k) {
+    return offsets[k + 1] - offsets[k];
+  });
+}
+
+/* Returns the items in [lo, hi) grouped by their keys, which are given
+ * by key_fn as in histogram, in increasing order of key, and such that
+ * the relative order of the items of each key is preserved. The items
+ * of key k are at the positions [offsets[k], offsets[k+1]) of the
+ * result. Up to 256 buckets, the items are moved by a single
+ * distribution pass; beyond, they are radix sorted by key.
+ */
+template <class Iter, class Key_fn>
+parray<value_type_of<Iter>> group_by_key(Iter lo, Iter hi, size_type nb_buckets,
+                                         const Key_fn& key_fn,
+                                         parray<size_type>& offsets) {
+  using value_type = value_type_of<Iter>;
+  size_type n = hi - lo;
+  parray<value_type> result;
+  if (n == 0) {
+    offsets.tabulate(nb_buckets + 1, [&] (size_type) {
+      return (size_type)0;
+    });
+    return result;
+  }
+  if (nb_buckets <= distribute_max_nb_buckets) {
+    const value_type* src = &lo[0];
+    result.reset(n);
+    bool moved = distribute_indexed(src, result.begin(), n, nb_buckets, distribute_nb_blocks(n), [&] (size_type i) {
+      return (size_type)key_fn(src[i]);
+    }, offsets);
+    if (! moved) {
+      sptl::copy(src, src + n, result.begin());
+    }
+    return result;
+  }
+  result.tabulate(n, [&] (size_type i) {
+    return lo[i];
+  });
+  sptl::radix_sort(result.begin(), result.end(), key_fn, __priv::nb_bits_of(nb_buckets));
+  offsets = __priv::offsets_of_sorted(n, nb_buckets, [&] (size_type i) {
+    return key_fn(result[i]);
+  });
+  return result;
+}
+
+/* Returns, in increasing order of key, the pairs (k, c) such that c > 0
+ * items x of [lo, hi) have the key k = key_fn(x), where the keys are
+ * unsigned integers of any width. The keys are radix sorted and the
+ * pairs are read off the runs of equal keys.
+ */
+template <class Iter, class Key_fn>
+parray<std::pair<__priv::key_type_of<Iter, Key_fn>, size_type>> count_by_key(Iter lo, Iter hi, const Key_fn& key_fn) {
+  using key_type = __priv::key_type_of<Iter, Key_fn>;
+  size_type n = hi - lo;
+  parray<key_type> keys(n, [&] (size_type i) {
+    return key_fn(lo[i]);
+  });
+  sptl::radix_sort(keys.begin(), keys.end(), [&] (key_type k) {
+    return k;
+  });
+  parray<bool> is_start(n, [&] (size_type i) {
+    return (i == 0) || (keys[i] != keys[i - 1]);
+  });
+  parray<size_type> starts = pack_index(is_start.cbegin(), is_start.cend());
+  size_type m = starts.size();
+  return parray<std::pair<key_type, size_type>>(m, [&] (size_type j) {
+    size_type next = (j + 1 < m) ? starts[j + 1] : n;
+    return std::make_pair(keys[starts[j]], next - starts[j]);
+  });
+}
+
+/*---------------------------------------------------------------------*/
+/* Semisorting */
+
+namespace __priv {
+
+// the hash of the key of an item, and the position of the item
+using semisort_record = std::pair<uint64_t, size_type>;
+
+static constexpr
+size_type semisort_leaf_size = 1 << 14;
+
+static constexpr
+int semisort_digit_nb_bits = 8;
+
+static constexpr
+size_type semisort_nb_buckets = 1 << semisort_digit_nb_bits;
+
+/* Regroups the items of keys that collide in a run of records of equal
+ * hashes, keeping the items of each key in their relative order. Since
+ * the hashes are 64 bits wide, a run usually holds one key, in which
+ * case the records are only scanned once.
+ */
+template <class Key_eq>
+void semisort_collisions(semisort_record* rs, size_type m, const Key_eq& key_eq) {
+  semisort_record* p = rs;
+  semisort_record* hi = rs + m;
+  while (p != hi) {
+    size_type i = p->second;
+    p = std::stable_partition(p + 1, hi, [&] (const semisort_record& r) {
+      return key_eq(i, r.second);
+    });
+  }
+}
+
+/* Groups the records by hash, looking at the digit of the hashes at
+ * shift and at the lower digits: the records are distributed by digit,
+ * and the buckets are grouped in parallel, by recursion, down to small
+ * buckets that are sorted sequentially. As the distribution is stable
+ * and the leaves are sorted by hash then position, the records of each
+ * key stay in increasing order of position.
+ */
+template <class Key_eq>
+void semisort_rec(semisort_record* rs, semisort_record* tmp, size_type n, int shift,
+                  const Key_eq& key_eq) {
+  if (shift < 0) {
+    // all the hashes are equal
+    bool same_key = level2::reduce(rs, rs + n, true, [&] (bool x, bool y) {
+      return x && y;
+    }, [&] (size_type, const semisort_record& r) {
+      return key_eq(rs[0].second, r.second);
+    }, [&] (const semisort_record* lo, const semisort_record* hi) {
+      bool b = true;
+      for (const semisort_record* r = lo; r != hi; r++) {
+        b = b && key_eq(rs[0].second, r->second);
+      }
+      return b;
+    });
+    if (! same_key) {
+      semisort_collisions(rs, n, key_eq);
+    }
+    return;
+  }
+  if (n <= semisort_leaf_size) {
+    std::sort(rs, rs + n);
+    for (size_type i = 0; i < n; ) {
+      size_type j = i + 1;
+      while (j < n && rs[j].first == rs[i].first) {
+        j++;
+      }
+      if (j - i > 1) {
+        semisort_collisions(rs + i, j - i, key_eq);
+      }
+      i = j;
+    }
+    return;
+  }
+  parray<size_type> offsets;
+  bool split = distribute(rs, tmp, n, semisort_nb_buckets, distribute_nb_blocks(n), [&] (const semisort_record& r) {
+    return (size_type)(r.first >> shift) & (semisort_nb_buckets - 1);
+  }, offsets);
+  if (! split) {
+    semisort_rec(rs, tmp, n, shift - semisort_digit_nb_bits, key_eq);
+    return;
+  }
+  parallel_for((size_type)0, semisort_nb_buckets, [&] (size_type lo, size_type hi) {
+    return offsets[hi] - offsets[lo];
+  }, [&] (size_type b) {
+    size_type lo = offsets[b];
+    size_type hi = offsets[b + 1];
+    sptl::copy(tmp + lo, tmp + hi, rs + lo);
+    semisort_rec(rs + lo, tmp + lo, hi - lo, shift - semisort_digit_nb_bits, key_eq);
+  });
+}
+
+// returns the records of the items of [lo, hi), grouped by key
+template <class Iter, class Key_fn, class Hash>
+parray<semisort_record> semisort_records(Iter lo, Iter hi, const Key_fn& key_fn, const Hash& hash) {
+  size_type n = hi - lo;
+  parray<semisort_record> rs(n, [&] (size_type i) {
+    return semisort_record(hash64((uint64_t)hash(key_fn(lo[i]))), i);
+  });
+  parray<semisort_record> tmp;
+  tmp.reset(n);
+  semisort_rec(rs.begin(), tmp.begin(), n, 64 - semisort_digit_nb_bits, [&] (size_type i, size_type j) {
+    return key_fn(lo[i]) == key_fn(lo[j]);
+  });
+  return rs;
+}
+
+} // end namespace
+
+/* Returns the items of [lo, hi) permuted so that the items of equal
+ * keys, given by key_fn and compared by ==, are contiguous, and in
+ * their relative order in [lo, hi). The groups of keys come in no
+ * particular order. The items are grouped by the hashes of their keys,
+ * which are given by hash, so the expected work is linear.
+ */
+template <class Iter, class Key_fn, class Hash>
+parray<value_type_of<Iter>> semisort(Iter lo, Iter hi, const Key_fn& key_fn, const Hash& hash) {
+  parray<__priv::semisort_record> rs = __priv::semisort_records(lo, hi, key_fn, hash);
+  return parray<value_type_of<Iter>>(rs.size(), [&] (size_type i) {
+    return lo[rs[i].second];
+  });
+}
+
+template <class Iter, class Key_fn>
+parray<value_type_of<Iter>> semisort(Iter lo, Iter hi, const Key_fn& key_fn) {
+  return semisort(lo, hi, key_fn, std::hash<__priv::key_type_of<Iter, Key_fn>>());
+}
+
+/* Returns, for each distinct key of the items in [lo, hi), the first
+ * item of [lo, hi) that has this key, with the keys given and hashed as
+ * by semisort. The items come in no particular order.
+ */
+template <class Iter, class Key_fn, class Hash>
+parray<value_type_of<Iter>> remove_duplicates(Iter lo, Iter hi, const Key_fn& key_fn, const Hash& hash) {
+  parray<__priv::semisort_record> rs = __priv::semisort_records(lo, hi, key_fn, hash);
+  parray<bool> is_first(rs.size(), [&] (size_type i) {
+    return (i == 0) || ! (key_fn(lo[rs[i - 1].second]) == key_fn(lo[rs[i].second]));
+  });
+  parray<size_type> firsts = pack_index(is_first.cbegin(), is_first.cend());
+  return parray<value_type_of<Iter>>(firsts.size(), [&] (size_type i) {
+    return lo[rs[firsts[i]].second];
+  });
+}
+
+template <class Iter, class Key_fn>
+parray<value_type_of<Iter>> remove_duplicates(Iter lo, Iter hi, const Key_fn& key_fn) {
+  return remove_duplicates(lo, hi, key_fn, std::hash<__priv::key_type_of<Iter, Key_fn>>());
+}
+
+template <class Iter>
+parray<value_type_of<Iter>> remove_duplicates(Iter lo, Iter hi) {
+  return remove_duplicates(lo, hi, [&] (const value_type_of<Iter>& x) {
+    return x;
+  });
+}
+
+/* Like std::unique, removes only the duplicates that are adjacent: the
+ * result keeps the first item of each run of consecutive items that are
+ * equal by eq. Equal items are thus expected to be next to each other,
+ * as in a sorted range, in which case the result holds the distinct
+ * items, in order. To remove the duplicates of a range in any order,
+ * use remove_duplicates.
+ */
+template <class Iter, class Eq>
+parray<value_type_of<Iter>> unique(Iter lo, Iter hi, const Eq& eq) {
+  return filteri(lo, hi, [&] (size_type i, reference_of<Iter> x) {
+    return (i == 0) || ! eq(lo[i - 1], x);
+  });
+}
+
+template <class Iter>
+parray<value_type_of<Iter>> unique(Iter lo, Iter hi) {
+  return unique(lo, hi, [&] (const value_type_of<Iter>& x, const value_type_of<Iter>& y) {
+    return x == y;
+  });
+}
+
+} // end namespace
+
+#endif
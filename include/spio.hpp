@@ -1,5 +1,16 @@
 
 #include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "spparray.hpp"
 #include "sppstring.hpp"
@@ -10,6 +21,383 @@
 
 namespace sptl {
 
+/*---------------------------------------------------------------------*/
+/* File input */
+
+/* A read-only memory mapping of a file, viewed as an array of items of
+ * type Item. The pages of the file are faulted in on construction by
+ * parallel reads, one per page, unless prefault is false, in which case
+ * they are faulted in by the first accesses.
+ */
+template <class Item>
+class mmap_view {
+public:
+  
+  using value_type = Item;
+  using size_type = sptl::size_type;
+  using const_reference = const value_type&;
+  using const_pointer = const value_type*;
+  using const_iterator = const_pointer;
+  
+private:
+  
+  static_assert(std::is_trivially_copyable<Item>::value,
+                "mmap_view requires a trivially copyable item type");
+  
+  static constexpr
+  size_type page_size = 1 << 12;
+  
+  void* addr = nullptr;
+  
+  size_type nb_bytes = 0;
+  
+  void map(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      die("cannot open %s", path.c_str());
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+      die("cannot stat %s", path.c_str());
+    }
+    nb_bytes = st.st_size;
+    if (nb_bytes % sizeof(value_type) != 0) {
+      die("size of %s is not a multiple of the item size", path.c_str());
+    }
+    if (nb_bytes > 0) {
+      addr = mmap(nullptr, nb_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        die("cannot map %s", path.c_str());
+      }
+      madvise(addr, nb_bytes, MADV_WILLNEED);
+    }
+    close(fd);
+  }
+  
+  void unmap() {
+    if (addr != nullptr) {
+      munmap(addr, nb_bytes);
+    }
+    addr = nullptr;
+    nb_bytes = 0;
+  }
+  
+public:
+  
+  mmap_view(const std::string& path, bool prefault = true) {
+    map(path);
+    if (prefault) {
+      this->prefault();
+    }
+  }
+  
+  mmap_view(const mmap_view&) = delete;
+  
+  mmap_view(mmap_view&& other)
+  : addr(other.addr), nb_bytes(other.nb_bytes) {
+    other.addr = nullptr;
+    other.nb_bytes = 0;
+  }
+  
+  ~mmap_view() {
+    unmap();
+  }
+  
+  // touches every page of the mapping, in parallel
+  void prefault() const {
+    const volatile char* p = (const volatile char*)addr;
+    size_type nb_pages = (nb_bytes + page_size - 1) / page_size;
+    parallel_for((size_type)0, nb_pages, [&] (size_type i) {
+      p[i * page_size];
+    });
+  }
+  
+  size_type size() const {
+    return nb_bytes / sizeof(value_type);
+  }
+  
+  const_reference operator[](size_type i) const {
+    assert(i < size());
+    return cbegin()[i];
+  }
+  
+  const_iterator cbegin() const {
+    return (const_pointer)addr;
+  }
+  
+  const_iterator cend() const {
+    return cbegin() + size();
+  }
+  
+};
+
+// returns the contents of the file at path, which are copied in
+// parallel, after the pages of the file are faulted in, if prefault
+inline
+pstring read_file(const std::string& path, bool prefault = true) {
+  mmap_view<char> view(path, prefault);
+  return pstring((char*)view.cbegin(), (char*)view.cend());
+}
+
+// returns the contents of the file at path, viewed as an array of items
+// of type Item, which are copied in parallel, after the pages of the
+// file are faulted in, if prefault
+template <class Item>
+parray<Item> read_binary(const std::string& path, bool prefault = true) {
+  mmap_view<Item> view(path, prefault);
+  return parray<Item>((Item*)view.cbegin(), (Item*)view.cend());
+}
+
+/*---------------------------------------------------------------------*/
+/* File output */
+
+namespace __priv {
+
+static constexpr
+size_type write_block_size = 1 << 20;
+
+static constexpr
+size_type format_block_size = 1 << 14;
+
+inline
+int open_for_writing(const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    die("cannot open %s", path.c_str());
+  }
+  return fd;
+}
+
+inline
+void close_after_writing(int fd, const std::string& path) {
+  if (close(fd) < 0) {
+    die("cannot write %s", path.c_str());
+  }
+}
+
+inline
+void pwrite_all(int fd, const char* buf, size_type n, off_t offset) {
+  while (n > 0) {
+    ssize_t r = pwrite(fd, buf, n, offset);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      die("write failed: %s", strerror(errno));
+    }
+    buf += r;
+    n -= r;
+    offset += r;
+  }
+}
+
+inline
+void writev_all(int fd, struct iovec* iov, size_type n) {
+  while (n > 0) {
+    int m = (int)std::min(n, (size_type)IOV_MAX);
+    ssize_t r = writev(fd, iov, m);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      die("write failed: %s", strerror(errno));
+    }
+    // skip the buffers that were written entirely, and advance in the
+    // first one that was not
+    for (; n > 0 && (size_type)r >= iov->iov_len; iov++, n--) {
+      r -= iov->iov_len;
+    }
+    if (n > 0) {
+      iov->iov_base = (char*)iov->iov_base + r;
+      iov->iov_len -= r;
+    }
+  }
+}
+
+/* Writes the buffers bufs[0], ..., bufs[n-1], of sizes sizes[0], ...,
+ * at the current offset of fd, in order. If fd is seekable, the buffers
+ * are written by positional writes, in parallel, at offsets given by a
+ * scan over their sizes; otherwise, they are written by a single
+ * gathering write.
+ */
+template <class Buffer, class Size>
+void write_buffers(int fd, size_type n, const Buffer& bufs, const Size& sizes) {
+  off_t base = lseek(fd, 0, SEEK_CUR);
+  if (base < 0) {
+    std::vector<struct iovec> iov(n);
+    for (size_type i = 0; i < n; i++) {
+      iov[i].iov_base = (void*)bufs(i);
+      iov[i].iov_len = sizes(i);
+    }
+    writev_all(fd, iov.data(), n);
+    return;
+  }
+  parray<size_type> offsets(n + 1, [&] (size_type i) {
+    return (i < n) ? (size_type)sizes(i) : 0;
+  });
+  size_type total = dps::scan(offsets.begin(), offsets.end(), (size_type)0,
+                              [&] (size_type x, size_type y) {
+                                return x + y;
+                              }, offsets.begin(), forward_exclusive_scan);
+  parallel_for((size_type)0, n, [&] (size_type lo, size_type hi) {
+    return offsets[hi] - offsets[lo] + (hi - lo);
+  }, [&] (size_type i) {
+    pwrite_all(fd, bufs(i), sizes(i), base + offsets[i]);
+  });
+  lseek(fd, base + total, SEEK_SET);
+}
+
+// writes the n bytes starting at lo, by positional writes of fixed-size
+// blocks, in parallel
+inline
+void write_bytes(int fd, const char* lo, size_type n) {
+  size_type nb_blocks = (n + write_block_size - 1) / write_block_size;
+  write_buffers(fd, nb_blocks, [&] (size_type b) {
+    return lo + b * write_block_size;
+  }, [&] (size_type b) {
+    return std::min(write_block_size, n - b * write_block_size);
+  });
+}
+
+template <class Item>
+typename std::enable_if<std::is_integral<Item>::value>::type
+format_item(const Item& x, std::string& dst) {
+  char buf[24];
+  char* p = buf + sizeof(buf);
+  bool neg = x < 0;
+  // work on the magnitude as an unsigned number, so that the smallest
+  // value of a signed type does not overflow
+  unsigned long long u = neg ? 0ull - (unsigned long long)x : (unsigned long long)x;
+  do {
+    *--p = '0' + (u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (neg) {
+    *--p = '-';
+  }
+  dst.append(p, buf + sizeof(buf));
+}
+
+// characters are written as such, as by operator<<, rather than as
+// integers
+inline
+void format_item(char x, std::string& dst) {
+  dst += x;
+}
+
+inline
+void format_item(signed char x, std::string& dst) {
+  dst += (char)x;
+}
+
+inline
+void format_item(unsigned char x, std::string& dst) {
+  dst += (char)x;
+}
+
+template <class Item>
+typename std::enable_if<std::is_floating_point<Item>::value>::type
+format_item(const Item& x, std::string& dst) {
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%.17g", (double)x);
+  dst.append(buf, n);
+}
+
+template <class Item>
+typename std::enable_if<! std::is_arithmetic<Item>::value>::type
+format_item(const Item& x, std::string& dst) {
+  std::ostringstream out;
+  out << x;
+  dst += out.str();
+}
+
+/* Writes the items lo[0], ..., lo[n-1], each followed by sep, as text:
+ * blocks of items are formatted in parallel into their own buffers,
+ * which are then written at once.
+ */
+template <class Iter>
+void write_text(int fd, Iter lo, size_type n, const char* sep) {
+  size_type nb_blocks = (n + format_block_size - 1) / format_block_size;
+  std::vector<std::string> bufs(nb_blocks);
+  parallel_for((size_type)0, nb_blocks, [&] (size_type lo, size_type hi) {
+    return std::min(n, hi * format_block_size) - lo * format_block_size;
+  }, [&] (size_type b) {
+    size_type i = b * format_block_size;
+    size_type hi = std::min(n, i + format_block_size);
+    std::string& buf = bufs[b];
+    Iter it = lo + i;
+    for (; i < hi; i++, it++) {
+      format_item(*it, buf);
+      buf += sep;
+    }
+  });
+  write_buffers(fd, nb_blocks, [&] (size_type b) {
+    return bufs[b].data();
+  }, [&] (size_type b) {
+    return bufs[b].size();
+  });
+}
+
+} // end namespace
+
+// writes the characters of s to the file at path
+inline
+void write_file(const std::string& path, const pstring& s) {
+  int fd = __priv::open_for_writing(path);
+  __priv::write_bytes(fd, s.c_str(), s.size());
+  __priv::close_after_writing(fd, path);
+}
+
+// writes the items of xs to the file at path, as text, each followed
+// by sep
+template <class Item>
+void write_text(const std::string& path, const parray<Item>& xs, const char* sep = "\n") {
+  int fd = __priv::open_for_writing(path);
+  __priv::write_text(fd, xs.cbegin(), xs.size(), sep);
+  __priv::close_after_writing(fd, path);
+}
+
+template <class Item>
+void write_text(const std::string& path, const pchunkedseq<Item>& xs, const char* sep = "\n") {
+  int fd = __priv::open_for_writing(path);
+  __priv::write_text(fd, xs.seq.cbegin(), xs.seq.size(), sep);
+  __priv::close_after_writing(fd, path);
+}
+
+// writes the bytes of the items of xs to the file at path, so that
+// read_binary<Item>(path) reads them back
+template <class Item>
+void write_binary(const std::string& path, const parray<Item>& xs) {
+  static_assert(std::is_trivially_copyable<Item>::value,
+                "write_binary requires a trivially copyable item type");
+  int fd = __priv::open_for_writing(path);
+  __priv::write_bytes(fd, (const char*)xs.cbegin(), xs.size() * sizeof(Item));
+  __priv::close_after_writing(fd, path);
+}
+
+// writes one buffer per chunk of xs, so that, like the other writers,
+// it falls back to a gathering write if the file is not seekable
+template <class Item>
+void write_binary(const std::string& path, const pchunkedseq<Item>& xs) {
+  static_assert(std::is_trivially_copyable<Item>::value,
+                "write_binary requires a trivially copyable item type");
+  std::vector<std::pair<const Item*, size_type>> segments;
+  pasl::data::chunkedseq::extras::for_each_segment(xs.seq.cbegin(), xs.seq.cend(),
+                                                   [&] (const Item* lo, const Item* hi) {
+    segments.push_back(std::make_pair(lo, (size_type)(hi - lo)));
+  });
+  int fd = __priv::open_for_writing(path);
+  __priv::write_buffers(fd, segments.size(), [&] (size_type i) {
+    return (const char*)segments[i].first;
+  }, [&] (size_type i) {
+    return segments[i].second * sizeof(Item);
+  });
+  __priv::close_after_writing(fd, path);
+}
+
+/*---------------------------------------------------------------------*/
+/* Printing */
+
 template <class Item>
 std::ostream& operator<<(std::ostream& out, const parray<Item>& xs) {
   out << "{ ";
@@ -24,9 +412,7 @@ std::ostream& operator<<(std::ostream& out, const parray<Item>& xs) {
 }
 
 std::ostream& operator<<(std::ostream& out, const pstring& xs) {
-  for (auto it = xs.cbegin(); it != xs.cend(); it++) {
-    out << *it;
-  }
+  out.write(xs.c_str(), xs.size());
   return out;
 }
 
@@ -0,0 +1,233 @@
+
+#include <locale.h>
+#include <stdlib.h>
+#include <limits>
+
+#include "sppstring.hpp"
+
+#ifndef _SPTL_PARSE_H_
+#define _SPTL_PARSE_H_
+
+namespace sptl {
+
+/*---------------------------------------------------------------------*/
+/* Parsing of numbers */
+
+/* The parsers below read one number that spans exactly the characters
+ * in [lo, hi), and return false if these characters do not form a
+ * number. They do not depend on the current locale: the decimal point
+ * is always '.'.
+ */
+
+static inline
+bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// reads an optional sign followed by one or more decimal digits
+inline
+bool parse_int(const char* lo, const char* hi, long& dst) {
+  const char* p = lo;
+  bool neg = false;
+  if (p != hi && (*p == '-' || *p == '+')) {
+    neg = (*p == '-');
+    p++;
+  }
+  if (p == hi) {
+    return false;
+  }
+  // accumulate the magnitude as a negative number, whose range is the
+  // larger one
+  long min = std::numeric_limits<long>::min();
+  long r = 0;
+  for (; p != hi; p++) {
+    if (! is_digit(*p)) {
+      return false;
+    }
+    long d = *p - '0';
+    if (r < (min + d) / 10) {
+      return false;
+    }
+    r = r * 10 - d;
+  }
+  if (! neg) {
+    if (r == min) {
+      return false;
+    }
+    r = -r;
+  }
+  dst = r;
+  return true;
+}
+
+namespace {
+
+static constexpr
+int max_exact_pow10 = 22;
+
+static
+const double exact_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+locale_t c_locale() {
+  static locale_t loc = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+  return loc;
+}
+
+} // end namespace
+
+/* Reads an optional sign, digits with an optional decimal point, with
+ * at least one digit, and an optional exponent. The usual case, where
+ * the digits fit in 53 bits and the decimal exponent is small, is
+ * computed exactly by a single multiplication or division; the other
+ * cases fall back to strtod_l in the "C" locale.
+ */
+inline
+bool parse_double(const char* lo, const char* hi, double& dst) {
+  const char* p = lo;
+  bool neg = false;
+  if (p != hi && (*p == '-' || *p == '+')) {
+    neg = (*p == '-');
+    p++;
+  }
+  unsigned long mantissa = 0;
+  int nb_digits = 0;
+  int nb_significant = 0;
+  int exp = 0;
+  for (; p != hi && is_digit(*p); p++, nb_digits++) {
+    if (nb_significant < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      nb_significant += (mantissa != 0);
+    } else {
+      exp++;
+    }
+  }
+  if (p != hi && *p == '.') {
+    p++;
+    for (; p != hi && is_digit(*p); p++, nb_digits++) {
+      if (nb_significant < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        nb_significant += (mantissa != 0);
+        exp--;
+      }
+    }
+  }
+  if (nb_digits == 0) {
+    return false;
+  }
+  if (p != hi && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool exp_neg = false;
+    if (p != hi && (*p == '-' || *p == '+')) {
+      exp_neg = (*p == '-');
+      p++;
+    }
+    if (p == hi) {
+      return false;
+    }
+    int e = 0;
+    for (; p != hi && is_digit(*p); p++) {
+      e = std::min(e * 10 + (*p - '0'), 100000);
+    }
+    exp += exp_neg ? -e : e;
+  }
+  if (p != hi) {
+    return false;
+  }
+  double r;
+  if (mantissa < (1ul << 53) && exp >= -max_exact_pow10 && exp <= max_exact_pow10) {
+    r = (double)mantissa;
+    r = (exp < 0) ? r / exact_pow10[-exp] : r * exact_pow10[exp];
+  } else {
+    char buf[128];
+    size_type n = hi - lo;
+    if (n >= sizeof(buf)) {
+      std::string s(lo, hi);
+      dst = strtod_l(s.c_str(), nullptr, c_locale());
+      return true;
+    }
+    memcpy(buf, lo, n);
+    buf[n] = '\0';
+    dst = strtod_l(buf, nullptr, c_locale());
+    return true;
+  }
+  dst = neg ? -r : r;
+  return true;
+}
+
+/*---------------------------------------------------------------------*/
+/* Parsing of sequences of numbers */
+
+namespace __priv {
+
+static constexpr
+const char* default_number_delims = " \t\r\n";
+
+template <class Number, class Parse>
+parray<Number> parse_numbers(const pstring& text,
+                             parray<size_type>& malformed,
+                             const char* delims,
+                             const Parse& parse) {
+  parray<pstring::token_type> tokens = text.split(delims);
+  size_type n = tokens.size();
+  const char* s = text.c_str();
+  parray<bool> bad;
+  bad.reset(n);
+  parray<Number> result(n, [&] (size_type i) {
+    const char* lo = s + tokens[i].first;
+    const char* hi = lo + tokens[i].second;
+    Number x = Number();
+    bad[i] = ! parse(lo, hi, x);
+    return x;
+  });
+  parray<size_type> idxs = pack_index(bad.cbegin(), bad.cend());
+  malformed.tabulate(idxs.size(), [&] (size_type i) {
+    return tokens[idxs[i]].first;
+  });
+  return result;
+}
+
+} // end namespace
+
+/* Reads the numbers in text, which are separated by runs of characters
+ * of delims. The malformed tokens are read as zeros, and their offsets
+ * in text are written, in order, to malformed.
+ */
+
+inline
+parray<long> parse_ints(const pstring& text,
+                        parray<size_type>& malformed,
+                        const char* delims = __priv::default_number_delims) {
+  return __priv::parse_numbers<long>(text, malformed, delims,
+                                     [&] (const char* lo, const char* hi, long& dst) {
+    return parse_int(lo, hi, dst);
+  });
+}
+
+inline
+parray<long> parse_ints(const pstring& text) {
+  parray<size_type> malformed;
+  return parse_ints(text, malformed);
+}
+
+inline
+parray<double> parse_doubles(const pstring& text,
+                             parray<size_type>& malformed,
+                             const char* delims = __priv::default_number_delims) {
+  return __priv::parse_numbers<double>(text, malformed, delims,
+                                       [&] (const char* lo, const char* hi, double& dst) {
+    return parse_double(lo, hi, dst);
+  });
+}
+
+inline
+parray<double> parse_doubles(const pstring& text) {
+  parray<size_type> malformed;
+  return parse_doubles(text, malformed);
+}
+
+} // end namespace
+
+#endif
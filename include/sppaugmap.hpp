@@ -0,0 +1,313 @@
+
+#include <limits>
+
+#include "sppset.hpp"
+
+#ifndef _SPTL_PAUGMAP_H_
+#define _SPTL_PAUGMAP_H_
+
+namespace sptl {
+
+/*---------------------------------------------------------------------*/
+/* Augmentations */
+
+/* An augmentation is a monoid over the entries of the map, given by a
+ * class that provides:
+ *   - value_type, the type of the aggregate values
+ *   - identity(), the identity element of the monoid
+ *   - combine(x, y), the associative operator of the monoid
+ *   - from_entry(k, v), the aggregate value of a single entry
+ */
+
+template <class Key, class Value>
+class aug_sum {
+public:
+
+  using value_type = Value;
+
+  static value_type identity() {
+    return value_type();
+  }
+
+  static value_type combine(const value_type& x, const value_type& y) {
+    return x + y;
+  }
+
+  static value_type from_entry(const Key&, const Value& v) {
+    return v;
+  }
+
+};
+
+template <class Key, class Value>
+class aug_count {
+public:
+
+  using value_type = size_type;
+
+  static value_type identity() {
+    return 0;
+  }
+
+  static value_type combine(value_type x, value_type y) {
+    return x + y;
+  }
+
+  static value_type from_entry(const Key&, const Value&) {
+    return 1;
+  }
+
+};
+
+template <class Key, class Value>
+class aug_max {
+public:
+
+  using value_type = Value;
+
+  static value_type identity() {
+    return std::numeric_limits<value_type>::lowest();
+  }
+
+  static value_type combine(const value_type& x, const value_type& y) {
+    return std::max(x, y);
+  }
+
+  static value_type from_entry(const Key&, const Value& v) {
+    return v;
+  }
+
+};
+
+namespace {
+
+  /* The cached measure of a sequence of entries: the last entry, which
+   * is used to search by key, together with the aggregate value of all
+   * the entries.
+   */
+  template <class Item, class Aug>
+  class augmented_optional : public optional<Item> {
+  public:
+
+    using self_type = augmented_optional<Item, Aug>;
+    using aug_type = typename Aug::value_type;
+
+    aug_type aug;
+
+    augmented_optional()
+    : optional<Item>(), aug(Aug::identity()) { }
+
+    augmented_optional(Item item)
+    : optional<Item>(item), aug(Aug::from_entry(item.first, item.second)) { }
+
+    augmented_optional(const augmented_optional& other)
+    : optional<Item>(other), aug(other.aug) { }
+
+    augmented_optional& operator=(const augmented_optional& other) = default;
+
+    void swap(self_type& other) {
+      optional<Item>::swap(other);
+      std::swap(aug, other.aug);
+    }
+
+  };
+
+  template <class Option, class Aug>
+  class take_right_and_combine {
+  public:
+
+    using value_type = Option;
+
+    static constexpr bool has_inverse = false;
+
+    static value_type identity() {
+      return value_type();
+    }
+
+    static value_type combine(value_type left, value_type right) {
+      value_type result = right.no_item ? left : right;
+      result.aug = Aug::combine(left.aug, right.aug);
+      return result;
+    }
+
+    static value_type inverse(value_type) {
+      return identity();
+    }
+
+  };
+
+  template <class Item, class Measured, class Algebra>
+  class combine_items {
+  public:
+
+    using value_type = Item;
+    using measured_type = Measured;
+
+    measured_type operator()(const value_type& v) const {
+      return measured_type(v);
+    }
+
+    measured_type operator()(const value_type* lo, const value_type* hi) const {
+      measured_type result = Algebra::identity();
+      for (const value_type* p = lo; p != hi; p++) {
+        result = Algebra::combine(result, measured_type(*p));
+      }
+      return result;
+    }
+  };
+
+  template <class Item, class Size, class Aug>
+  class paugmented_cache {
+  public:
+
+    using size_type = Size;
+    using value_type = Item;
+    using optional_type = augmented_optional<value_type, Aug>;
+    using algebra_type = take_right_and_combine<optional_type, Aug>;
+    using measured_type = typename algebra_type::value_type; // = optional_type
+    using measure_type = combine_items<value_type, measured_type, algebra_type>;
+
+    static void swap(measured_type& x, measured_type& y) {
+      x.swap(y);
+    }
+
+  };
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+/* Augmented map */
+
+/* Ordered map that, in addition to the key of its last entry, caches
+ * in every chunk and every node of the underlying chunked sequence the
+ * aggregate value of the entries below, so that the aggregate of any
+ * range of keys can be computed in logarithmic time.
+ *
+ * The mapped values can be changed only through insert and erase,
+ * which keep the cached aggregates up to date.
+ */
+template <
+  class Key,
+  class Item,
+  class Aug = aug_sum<Key, Item>,
+  class Compare = std::less<Key>,
+  class Alloc = std::allocator<std::pair<Key, Item>>,
+  int chunk_capacity = 8
+>
+class paugmented_map {
+public:
+
+  using key_type = Key;
+  using mapped_type = Item;
+  using value_type = std::pair<key_type, mapped_type>;
+  using aug_type = typename Aug::value_type;
+  using key_compare = Compare;
+  using allocator_type = Alloc;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using difference_type = ptrdiff_t;
+  using size_type = sptl::size_type;
+  class value_compare {
+  public:
+
+    bool operator()(const value_type& lhs, const value_type& rhs) const {
+      Compare comp;
+      return comp(lhs.first, rhs.first);
+    }
+
+  };
+  using cache_type = paugmented_cache<value_type, size_type, Aug>;
+  using pset_type = pset<value_type, value_compare, allocator_type, chunk_capacity, cache_type>;
+  using iterator = typename pset_type::iterator;
+  using const_iterator = typename pset_type::const_iterator;
+
+  pset_type set;
+
+  paugmented_map() { }
+
+  paugmented_map(const paugmented_map& other)
+  : set(other.set) { }
+
+  paugmented_map(paugmented_map&& other)
+  : set(std::move(other.set)) { }
+
+  paugmented_map(std::initializer_list<value_type> xs)
+  : set(xs) { }
+
+  template <class Iter>
+  paugmented_map(Iter lo, Iter hi)
+  : set(lo, hi) { }
+
+  paugmented_map(size_type sz, const std::function<value_type(size_type)>& body)
+  : set(sz, body) { }
+
+  paugmented_map(size_type sz,
+                 const std::function<size_type(size_type)>& body_comp,
+                 const std::function<value_type(size_type)>& body)
+  : set(sz, body_comp, body) { }
+
+  size_type size() const {
+    return set.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  const_iterator find(const key_type& k) const {
+    return set.find(std::make_pair(k, mapped_type()));
+  }
+
+  std::pair<iterator,bool> insert(const value_type& val) {
+    return set.insert(val);
+  }
+
+  size_type erase(const key_type& k) {
+    return set.erase(std::make_pair(k, mapped_type()));
+  }
+
+  template <class Iter>
+  void insert_batch(Iter lo, Iter hi) {
+    set.insert_batch(lo, hi);
+  }
+
+  // returns the aggregate value of the entries whose keys are in [lo,
+  // hi); not const, and not safe to call concurrently with any other
+  // call on the same map, because it splits and rejoins the container
+  // (see pset::measure_range)
+  aug_type aug_range(const key_type& lo, const key_type& hi) {
+    return set.measure_range(std::make_pair(lo, mapped_type()),
+                             std::make_pair(hi, mapped_type())).aug;
+  }
+
+  void merge(paugmented_map& other) {
+    set.merge(other.set);
+  }
+
+  void intersect(paugmented_map& other) {
+    set.intersect(other.set);
+  }
+
+  void diff(paugmented_map& other) {
+    set.diff(other.set);
+  }
+
+  void clear() {
+    set.clear();
+  }
+
+  const_iterator cbegin() const {
+    return set.cbegin();
+  }
+
+  const_iterator cend() const {
+    return set.cend();
+  }
+
+};
+
+} // end namespace
+
+#endif
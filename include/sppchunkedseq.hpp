@@ -68,6 +68,27 @@ void copy_dst(Iter lo, Iter hi, Chunkedseq& dst) {
   reduce(lo, hi, out, id, dst, lift_comp_rng, lift_rng_dst, seq_rng_dst);
 }
   
+// appends to dst, in order, the items of [lo, hi) that satisfy pred
+template <class Iter, class Chunkedseq, class Pred>
+void filter_dst(Iter lo, Iter hi, Chunkedseq& dst, const Pred& pred) {
+  using pointer = pointer_of<Iter>;
+  using output_type = level3::chunkedseq_output<Chunkedseq>;
+  Chunkedseq id;
+  output_type out;
+  auto lift_comp_rng = [&] (Iter lo, Iter hi) {
+    return hi - lo;
+  };
+  auto lift_rng_dst = [&] (size_type, pointer lo, pointer hi, Chunkedseq& dst) {
+    for (pointer p = lo; p != hi; p++) {
+      if (pred(*p)) {
+        dst.push_back(*p);
+      }
+    }
+  };
+  auto seq_rng_dst = lift_rng_dst;
+  reduce(lo, hi, out, id, dst, lift_comp_rng, lift_rng_dst, seq_rng_dst);
+}
+  
 template <class Item, class Chunkedseq>
 void fill_dst(size_type n, const Item& x, Chunkedseq& dst) {
   using value_type = Item;
@@ -92,11 +113,14 @@ void for_each_segmenti(Iter lo, Iter hi, const Visit_segment_idx& visit_segment_
   output_type out;
   int id = 0;
   int result = id;
+  auto lift_comp_rng = [&] (Iter lo, Iter hi) {
+    return hi - lo;
+  };
   auto lift_rng_dst = [&] (size_type i, pointer_of<Iter> lo, pointer_of<Iter> hi, int&) {
     visit_segment_idx(i, lo, hi);
   };
   auto seq_rng_dst = lift_rng_dst;
-  reduce(lo, hi, out, id, result, lift_rng_dst, seq_rng_dst);
+  reduce(lo, hi, out, id, result, lift_comp_rng, lift_rng_dst, seq_rng_dst);
 }
  
 template <class Iter, class Visit_segment>
@@ -145,11 +169,11 @@ void tabulate_rng_dst(size_type n,
     return body_comp_rng(in.lo, in.hi);
   };
   size_type chunk_capacity = dst.chunk_capacity;
-  parray<value_type> tmp(chunk_capacity);
   auto convert = [&] (input_type& in, Chunkedseq& dst) {
+    parray<value_type> tmp(chunk_capacity);
     dst.stream_pushn_back([&] (size_type i, size_type n) {
       for (size_type k = 0; k < n; k++) {
-        body_idx_dst(k + in.lo, tmp[k]);
+        body_idx_dst(in.lo + i + k, tmp[k]);
       }
       const value_type* lo = &tmp[0];
       const value_type* hi = &tmp[n-1]+1;
@@ -183,6 +207,109 @@ void tabulate_dst(size_type n,
   tabulate_rng_dst(n, body_comp_rng, dst, body_idx_dst);
 }
   
+/* Reads the items in [lo, hi) from front to back, one segment at a time:
+ * moving to the next item costs a pointer increment, except at segment
+ * boundaries, where the iterator fetches the next segment.
+ */
+template <class Iter>
+class segment_reader {
+public:
+  
+  using pointer = pointer_of<Iter>;
+  using reference = reference_of<Iter>;
+  
+private:
+  
+  // position of the first item in [seg_lo, seg_hi)
+  Iter it;
+  Iter hi;
+  pointer seg_lo;
+  pointer seg_hi;
+  pointer cur;
+  
+  void load() {
+    seg_lo = seg_hi = cur = nullptr;
+    if (it == hi) {
+      return;
+    }
+    auto seg = it.get_segment();
+    size_type n = std::min((size_type)(seg.end - seg.middle), (size_type)(hi - it));
+    seg_lo = cur = seg.middle;
+    seg_hi = seg.middle + n;
+  }
+  
+public:
+  
+  segment_reader(Iter lo, Iter hi)
+  : it(lo), hi(hi) {
+    load();
+  }
+  
+  bool empty() const {
+    return cur == seg_hi;
+  }
+  
+  reference front() const {
+    assert(! empty());
+    return *cur;
+  }
+  
+  void pop_front() {
+    assert(! empty());
+    cur++;
+    if (cur == seg_hi) {
+      it += seg_hi - seg_lo;
+      load();
+    }
+  }
+  
+  // position of the front item, or hi if there is none
+  Iter position() const {
+    return it + (cur - seg_lo);
+  }
+  
+};
+  
+/* Buffers items to be pushed on the back of a chunked sequence, so that
+ * they are pushed a chunk at a time.
+ */
+template <class Chunkedseq>
+class chunk_writer {
+public:
+  
+  using value_type = typename Chunkedseq::value_type;
+  
+private:
+  
+  Chunkedseq& dst;
+  parray<value_type> buf;
+  size_type nb;
+  
+public:
+  
+  chunk_writer(Chunkedseq& dst)
+  : dst(dst), buf(dst.chunk_capacity), nb(0) { }
+  
+  ~chunk_writer() {
+    flush();
+  }
+  
+  void push_back(const value_type& x) {
+    buf[nb++] = x;
+    if (nb == buf.size()) {
+      flush();
+    }
+  }
+  
+  void flush() {
+    if (nb > 0) {
+      dst.pushn_back(buf.cbegin(), nb);
+      nb = 0;
+    }
+  }
+  
+};
+  
 template <class Pred, class Chunkedseq>
 void keep_if(const Pred& p, Chunkedseq& xs, Chunkedseq& dst) {
   using input_type = level4::chunkedseq_input<Chunkedseq>;
@@ -0,0 +1,141 @@
+
+#include "sppersistentset.hpp"
+
+#ifndef _SPTL_PERSISTENTMAP_H_
+#define _SPTL_PERSISTENTMAP_H_
+
+namespace sptl {
+
+template <
+  class Key,
+  class Item,
+  class Compare = std::less<Key>
+>
+class persistent_pmap {
+public:
+
+  using key_type = Key;
+  using mapped_type = Item;
+  using value_type = std::pair<key_type, mapped_type>;
+  using key_compare = Compare;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using size_type = sptl::size_type;
+  class value_compare {
+  public:
+
+    bool operator()(const value_type& lhs, const value_type& rhs) const {
+      Compare comp;
+      return comp(lhs.first, rhs.first);
+    }
+
+  };
+  using set_type = persistent_pset<value_type, value_compare>;
+
+  set_type set;
+
+  persistent_pmap() { }
+
+  persistent_pmap(const persistent_pmap& other)
+  : set(other.set) { }
+
+  persistent_pmap(persistent_pmap&& other)
+  : set(std::move(other.set)) { }
+
+  persistent_pmap(std::initializer_list<value_type> xs)
+  : set(xs) { }
+
+  template <class Iter>
+  persistent_pmap(Iter lo, Iter hi)
+  : set(lo, hi) { }
+
+  persistent_pmap& operator=(const persistent_pmap& other) {
+    set = other.set;
+    return *this;
+  }
+
+  persistent_pmap& operator=(persistent_pmap&& other) {
+    set = std::move(other.set);
+    return *this;
+  }
+
+  persistent_pmap snapshot() const {
+    return *this;
+  }
+
+  size_type size() const {
+    return set.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  const_pointer find(const key_type& k) const {
+    return set.find(std::make_pair(k, mapped_type()));
+  }
+
+  size_type count(const key_type& k) const {
+    return set.count(std::make_pair(k, mapped_type()));
+  }
+
+  bool insert(const value_type& val) {
+    return set.insert(val);
+  }
+
+  // replaces the entry of the same key, if there is one
+  void insert_or_assign(const value_type& val) {
+    set.erase(val);
+    set.insert(val);
+  }
+
+  size_type erase(const key_type& k) {
+    return set.erase(std::make_pair(k, mapped_type()));
+  }
+
+  void merge(const persistent_pmap& other) {
+    set.merge(other.set);
+  }
+
+  void intersect(const persistent_pmap& other) {
+    set.intersect(other.set);
+  }
+
+  void diff(const persistent_pmap& other) {
+    set.diff(other.set);
+  }
+
+  template <class Iter>
+  void insert_batch(Iter lo, Iter hi) {
+    set.insert_batch(lo, hi);
+  }
+
+  // Iter: iterator over keys
+  template <class Iter>
+  size_type erase_batch(Iter lo, Iter hi) {
+    parray<value_type> vals(hi - lo, [&] (size_type i) {
+      return std::make_pair(*(lo + i), mapped_type());
+    });
+    return set.erase_batch(vals.cbegin(), vals.cend());
+  }
+
+  void clear() {
+    set.clear();
+  }
+
+  template <class Body>
+  void for_each(const Body& body) const {
+    set.for_each(body);
+  }
+
+  parray<value_type> elements() const {
+    return set.elements();
+  }
+
+};
+
+} // end namespace
+
+#endif
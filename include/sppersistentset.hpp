@@ -0,0 +1,560 @@
+
+#include <atomic>
+#include <cstdint>
+
+#include "spsort.hpp"
+
+#ifndef _SPTL_PERSISTENTSET_H_
+#define _SPTL_PERSISTENTSET_H_
+
+namespace sptl {
+
+/*---------------------------------------------------------------------*/
+/* Persistent treaps */
+
+namespace {
+
+__thread
+uint64_t treap_seed = 0;
+
+// returns a nonzero pseudo-random priority, from a per-thread xorshift
+// generator
+static inline
+unsigned treap_priority() {
+  if (treap_seed == 0) {
+    treap_seed = 0x9e3779b97f4a7c15ULL ^ (uint64_t)&treap_seed;
+  }
+  treap_seed ^= treap_seed << 13;
+  treap_seed ^= treap_seed >> 7;
+  treap_seed ^= treap_seed << 17;
+  return (unsigned)(treap_seed >> 32) | 1;
+}
+
+template <class Body1, class Body2>
+void par_do(size_type n, const Body1& body1, const Body2& body2) {
+  spguard([&] { return n; }, [&] {
+    fork2(body1, body2);
+  }, [&] {
+    body1();
+    body2();
+  });
+}
+
+/* Search trees whose nodes are immutable once shared and are
+ * reference counted, so that any number of trees can share subtrees.
+ * A tree is a pointer to its root node, and every pointer that is
+ * passed to, or returned from, the functions below carries one
+ * reference, unless documented otherwise. Updates copy the nodes on
+ * the path from the root to the update, and take a node over in place
+ * when the caller holds its only reference.
+ *
+ * The trees are balanced as treaps with random priorities, and all
+ * bulk operations are built on join, following the join-based
+ * algorithms of Blelloch, Ferizovic and Sun, so that, for instance,
+ * the union of trees of sizes m <= n takes O(m log(n/m + 1)) work.
+ */
+template <class Item, class Compare>
+class treap {
+public:
+
+  class node {
+  public:
+
+    Item item;
+    unsigned priority;
+    size_type size;
+    node* left;
+    node* right;
+    std::atomic<long> refcount;
+
+    node(node* left, const Item& item, unsigned priority, node* right)
+    : item(item), priority(priority), left(left), right(right), refcount(1) {
+      size = treap::size(left) + treap::size(right) + 1;
+    }
+
+  };
+
+  static size_type size(const node* t) {
+    return (t == nullptr) ? 0 : t->size;
+  }
+
+  static unsigned priority(const node* t) {
+    return (t == nullptr) ? 0 : t->priority;
+  }
+
+  static bool same_key(const Item& x, const Item& y) {
+    Compare comp;
+    return (! comp(x, y)) && (! comp(y, x));
+  }
+
+  static node* retain(node* t) {
+    if (t != nullptr) {
+      t->refcount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return t;
+  }
+
+  static void release(node* t) {
+    if (t == nullptr) {
+      return;
+    }
+    if (t->refcount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    node* l = t->left;
+    node* r = t->right;
+    size_type n = t->size;
+    delete t;
+    par_do(n, [&] {
+      release(l);
+    }, [&] {
+      release(r);
+    });
+  }
+
+  // consumes t, and gives back its item, its priority and its children
+  static void expose(node* t, node*& l, Item& x, unsigned& p, node*& r) {
+    x = t->item;
+    p = t->priority;
+    if (t->refcount.load(std::memory_order_acquire) == 1) {
+      l = t->left;
+      r = t->right;
+      delete t;
+    } else {
+      l = retain(t->left);
+      r = retain(t->right);
+      release(t);
+    }
+  }
+
+  // requires that all the keys of l be smaller than x and all the keys
+  // of r be larger
+  static node* join(node* l, const Item& x, unsigned p, node* r) {
+    if ((p >= priority(l)) && (p >= priority(r))) {
+      return new node(l, x, p, r);
+    }
+    node* c1;
+    node* c2;
+    Item y;
+    unsigned q;
+    if (priority(l) > priority(r)) {
+      expose(l, c1, y, q, c2);
+      return new node(c1, y, q, join(c2, x, p, r));
+    } else {
+      expose(r, c1, y, q, c2);
+      return new node(join(l, x, p, c1), y, q, c2);
+    }
+  }
+
+  // requires that all the keys of l be smaller than all the keys of r
+  static node* join2(node* l, node* r) {
+    if (l == nullptr) {
+      return r;
+    }
+    if (r == nullptr) {
+      return l;
+    }
+    node* c1;
+    node* c2;
+    Item y;
+    unsigned q;
+    if (priority(l) > priority(r)) {
+      expose(l, c1, y, q, c2);
+      return new node(c1, y, q, join2(c2, r));
+    } else {
+      expose(r, c1, y, q, c2);
+      return new node(join2(l, c1), y, q, c2);
+    }
+  }
+
+  /* Splits t into the trees l and r of the keys smaller and larger
+   * than k, respectively, and returns true if t holds k, in which case
+   * the item of key k is written to found, unless found is null.
+   */
+  static bool split(node* t, const Item& k, node*& l, node*& r, Item* found = nullptr) {
+    if (t == nullptr) {
+      l = r = nullptr;
+      return false;
+    }
+    Compare comp;
+    node* tl;
+    node* tr;
+    Item x;
+    unsigned p;
+    expose(t, tl, x, p, tr);
+    bool result;
+    node* m;
+    if (comp(k, x)) {
+      result = split(tl, k, l, m, found);
+      r = new node(m, x, p, tr);
+    } else if (comp(x, k)) {
+      result = split(tr, k, m, r, found);
+      l = new node(tl, x, p, m);
+    } else {
+      l = tl;
+      r = tr;
+      result = true;
+      if (found != nullptr) {
+        *found = x;
+      }
+    }
+    return result;
+  }
+
+  // t is not consumed
+  static const Item* find(const node* t, const Item& k) {
+    Compare comp;
+    while (t != nullptr) {
+      if (comp(k, t->item)) {
+        t = t->left;
+      } else if (comp(t->item, k)) {
+        t = t->right;
+      } else {
+        return &t->item;
+      }
+    }
+    return nullptr;
+  }
+
+  // requires that t not hold the key of x
+  static node* insert(node* t, const Item& x, unsigned p) {
+    if (p > priority(t)) {
+      node* l;
+      node* r;
+      split(t, x, l, r);
+      return new node(l, x, p, r);
+    }
+    Compare comp;
+    node* tl;
+    node* tr;
+    Item y;
+    unsigned q;
+    expose(t, tl, y, q, tr);
+    if (comp(x, y)) {
+      return new node(insert(tl, x, p), y, q, tr);
+    } else {
+      return new node(tl, y, q, insert(tr, x, p));
+    }
+  }
+
+  // requires that t hold the key k
+  static node* erase(node* t, const Item& k) {
+    Compare comp;
+    node* tl;
+    node* tr;
+    Item y;
+    unsigned q;
+    expose(t, tl, y, q, tr);
+    if (comp(k, y)) {
+      return new node(erase(tl, k), y, q, tr);
+    } else if (comp(y, k)) {
+      return new node(tl, y, q, erase(tr, k));
+    } else {
+      return join2(tl, tr);
+    }
+  }
+
+  // on keys present in both trees, keeps the item of a
+  static node* set_union(node* a, node* b) {
+    if (a == nullptr) {
+      return b;
+    }
+    if (b == nullptr) {
+      return a;
+    }
+    node* l1;
+    node* r1;
+    Item x;
+    unsigned p;
+    expose(a, l1, x, p, r1);
+    node* l2;
+    node* r2;
+    split(b, x, l2, r2);
+    node* l;
+    node* r;
+    par_do(size(l1) + size(l2) + size(r1) + size(r2), [&] {
+      l = set_union(l1, l2);
+    }, [&] {
+      r = set_union(r1, r2);
+    });
+    return join(l, x, p, r);
+  }
+
+  static node* set_intersection(node* a, node* b) {
+    if ((a == nullptr) || (b == nullptr)) {
+      release(a);
+      release(b);
+      return nullptr;
+    }
+    node* l1;
+    node* r1;
+    Item x;
+    unsigned p;
+    expose(a, l1, x, p, r1);
+    node* l2;
+    node* r2;
+    bool found = split(b, x, l2, r2);
+    node* l;
+    node* r;
+    par_do(size(l1) + size(l2) + size(r1) + size(r2), [&] {
+      l = set_intersection(l1, l2);
+    }, [&] {
+      r = set_intersection(r1, r2);
+    });
+    return found ? join(l, x, p, r) : join2(l, r);
+  }
+
+  // returns a - b
+  static node* set_difference(node* a, node* b) {
+    if ((a == nullptr) || (b == nullptr)) {
+      release(b);
+      return a;
+    }
+    node* l2;
+    node* r2;
+    Item y;
+    unsigned q;
+    expose(b, l2, y, q, r2);
+    node* l1;
+    node* r1;
+    split(a, y, l1, r1);
+    node* l;
+    node* r;
+    par_do(size(l1) + size(l2) + size(r1) + size(r2), [&] {
+      l = set_difference(l1, l2);
+    }, [&] {
+      r = set_difference(r1, r2);
+    });
+    return join2(l, r);
+  }
+
+  // requires that the items of [lo, lo + n) be sorted and have distinct keys
+  static node* build(const Item* lo, size_type n) {
+    if (n == 0) {
+      return nullptr;
+    }
+    size_type mid = n / 2;
+    node* l;
+    node* r;
+    par_do(n, [&] {
+      l = build(lo, mid);
+    }, [&] {
+      r = build(lo + mid + 1, n - mid - 1);
+    });
+    return join(l, lo[mid], treap_priority(), r);
+  }
+
+  // writes the items of t, in order, starting at dst; t is not consumed
+  static void flatten(const node* t, Item* dst) {
+    if (t == nullptr) {
+      return;
+    }
+    size_type nl = size(t->left);
+    dst[nl] = t->item;
+    par_do(t->size, [&] {
+      flatten(t->left, dst);
+    }, [&] {
+      flatten(t->right, dst + nl + 1);
+    });
+  }
+
+  // t is not consumed
+  template <class Body>
+  static void for_each(node* t, const Body& body) {
+    if (t == nullptr) {
+      return;
+    }
+    body(t->item);
+    par_do(t->size, [&] {
+      for_each(t->left, body);
+    }, [&] {
+      for_each(t->right, body);
+    });
+  }
+
+};
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+/* Persistent set */
+
+/* Ordered set whose versions share structure: copying a set takes
+ * constant time, after which the two copies can be updated
+ * independently, so that copies serve as consistent snapshots for
+ * readers while a writer applies updates. Reference counts are atomic,
+ * so copies can be taken and dropped by concurrent tasks, as long as
+ * each set object is updated by one task at a time.
+ */
+template <
+  class Item,
+  class Compare = std::less<Item>
+>
+class persistent_pset {
+public:
+
+  using key_type = Item;
+  using value_type = Item;
+  using key_compare = Compare;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using size_type = sptl::size_type;
+
+private:
+
+  using tree = treap<value_type, key_compare>;
+  using node_type = typename tree::node;
+
+  node_type* root = nullptr;
+
+  explicit persistent_pset(node_type* root)
+  : root(root) { }
+
+  // returns the items of [lo, hi) sorted by key, keeping only the first
+  // of the items that share a key
+  template <class Iter>
+  static parray<value_type> sorted_batch(Iter lo, Iter hi) {
+    key_compare compare;
+    parray<value_type> xs(hi - lo, [&] (size_type i) {
+      return *(lo + i);
+    });
+    sptl::stable_sort(xs.begin(), xs.end(), compare);
+    return filteri(xs.cbegin(), xs.cend(), [&] (size_type i, const value_type& x) {
+      return (i == 0) || (! tree::same_key(xs[i - 1], x));
+    });
+  }
+
+  template <class Iter>
+  static node_type* build(Iter lo, Iter hi) {
+    parray<value_type> xs = sorted_batch(lo, hi);
+    return tree::build(xs.cbegin(), xs.size());
+  }
+
+public:
+
+  persistent_pset() { }
+
+  ~persistent_pset() {
+    tree::release(root);
+  }
+
+  // takes a snapshot of other, in constant time
+  persistent_pset(const persistent_pset& other)
+  : root(tree::retain(other.root)) { }
+
+  persistent_pset(persistent_pset&& other)
+  : root(other.root) {
+    other.root = nullptr;
+  }
+
+  persistent_pset(std::initializer_list<value_type> xs)
+  : root(build(xs.begin(), xs.end())) { }
+
+  template <class Iter>
+  persistent_pset(Iter lo, Iter hi)
+  : root(build(lo, hi)) { }
+
+  persistent_pset& operator=(const persistent_pset& other) {
+    node_type* old = root;
+    root = tree::retain(other.root);
+    tree::release(old);
+    return *this;
+  }
+
+  persistent_pset& operator=(persistent_pset&& other) {
+    std::swap(root, other.root);
+    return *this;
+  }
+
+  persistent_pset snapshot() const {
+    return *this;
+  }
+
+  size_type size() const {
+    return tree::size(root);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // returns a pointer to the item of key k, or nullptr if there is none
+  const_pointer find(const key_type& k) const {
+    return tree::find(root, k);
+  }
+
+  size_type count(const key_type& k) const {
+    return (find(k) == nullptr) ? 0 : 1;
+  }
+
+  // returns false if the key of x is already present
+  bool insert(const value_type& x) {
+    if (find(x) != nullptr) {
+      return false;
+    }
+    root = tree::insert(root, x, treap_priority());
+    return true;
+  }
+
+  size_type erase(const key_type& k) {
+    if (find(k) == nullptr) {
+      return 0;
+    }
+    root = tree::erase(root, k);
+    return 1;
+  }
+
+  /* The following bulk operations leave other unchanged, and share
+   * with it the subtrees that they do not need to touch.
+   */
+
+  void merge(const persistent_pset& other) {
+    root = tree::set_union(root, tree::retain(other.root));
+  }
+
+  void intersect(const persistent_pset& other) {
+    root = tree::set_intersection(root, tree::retain(other.root));
+  }
+
+  void diff(const persistent_pset& other) {
+    root = tree::set_difference(root, tree::retain(other.root));
+  }
+
+  // keeps the items already present on keys that the batch repeats
+  template <class Iter>
+  void insert_batch(Iter lo, Iter hi) {
+    root = tree::set_union(root, build(lo, hi));
+  }
+
+  template <class Iter>
+  size_type erase_batch(Iter lo, Iter hi) {
+    size_type nb = size();
+    root = tree::set_difference(root, build(lo, hi));
+    return nb - size();
+  }
+
+  void clear() {
+    tree::release(root);
+    root = nullptr;
+  }
+
+  template <class Body>
+  void for_each(const Body& body) const {
+    tree::for_each(root, body);
+  }
+
+  // returns the items of the set in ascending order
+  parray<value_type> elements() const {
+    parray<value_type> result;
+    result.reset(size());
+    tree::flatten(root, result.begin());
+    return result;
+  }
+
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,135 @@
+
+#include "spphashset.hpp"
+
+#ifndef _SPTL_PHASHMAP_H_
+#define _SPTL_PHASHMAP_H_
+
+namespace sptl {
+
+template <
+  class Key,
+  class Item,
+  class Hash = std::hash<Key>,
+  class Equal = std::equal_to<Key>
+>
+class phash_map {
+public:
+
+  using key_type = Key;
+  using mapped_type = Item;
+  using value_type = std::pair<key_type, mapped_type>;
+  using hasher = Hash;
+  using key_equal = Equal;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using size_type = sptl::size_type;
+  class value_hash {
+  public:
+
+    size_t operator()(const value_type& x) const {
+      hasher h;
+      return h(x.first);
+    }
+
+  };
+  class value_equal {
+  public:
+
+    bool operator()(const value_type& lhs, const value_type& rhs) const {
+      key_equal eq;
+      return eq(lhs.first, rhs.first);
+    }
+
+  };
+  using phash_set_type = phash_set<value_type, value_hash, value_equal>;
+
+  phash_set_type set;
+
+  phash_map() { }
+
+  phash_map(const phash_map& other)
+  : set(other.set) { }
+
+  phash_map(phash_map&& other)
+  : set(std::move(other.set)) { }
+
+  phash_map& operator=(const phash_map& other) {
+    set = other.set;
+    return *this;
+  }
+
+  phash_map& operator=(phash_map&& other) {
+    set = std::move(other.set);
+    return *this;
+  }
+
+  phash_map(std::initializer_list<value_type> xs)
+  : set(xs) { }
+
+  template <class Iter>
+  phash_map(Iter lo, Iter hi)
+  : set(lo, hi) { }
+
+  phash_map(size_type sz, const std::function<value_type(size_type)>& body)
+  : set(sz, body) { }
+
+  size_type size() const {
+    return set.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  void reserve(size_type n) {
+    set.reserve(n);
+  }
+
+  pointer find(const key_type& k) const {
+    return set.find(std::make_pair(k, mapped_type()));
+  }
+
+  size_type count(const key_type& k) const {
+    return set.count(std::make_pair(k, mapped_type()));
+  }
+
+  std::pair<pointer, bool> insert(const value_type& val) {
+    return set.insert(val);
+  }
+
+  std::pair<pointer, bool> concurrent_insert(const value_type& val) {
+    return set.concurrent_insert(val);
+  }
+
+  size_type erase(const key_type& k) {
+    return set.erase(std::make_pair(k, mapped_type()));
+  }
+
+  mapped_type& operator[] (const key_type& k) {
+    return set.insert(std::make_pair(k, mapped_type())).first->second;
+  }
+
+  void clear() {
+    set.clear();
+  }
+
+  void swap(phash_map& other) {
+    set.swap(other.set);
+  }
+
+  template <class Body>
+  void for_each(const Body& body) const {
+    set.for_each(body);
+  }
+
+  parray<value_type> elements() const {
+    return set.elements();
+  }
+
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,400 @@
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "spperworker.hpp"
+#include "spdataparallel.hpp"
+
+#ifndef _SPTL_PHASHSET_H_
+#define _SPTL_PHASHSET_H_
+
+namespace sptl {
+
+namespace {
+
+// scrambles the bits of a hash value, so that keys whose hash values
+// differ only in their high-order bits do not collide
+static inline
+uint64_t mix_hash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+/* Parallel hash set */
+
+/* Unordered set, stored in an open-addressing table with linear probing.
+ *
+ * The table supports phase-concurrent use: concurrent_insert and find
+ * may be called concurrently by any number of tasks, provided that no
+ * other operation runs at the same time and that the table has been
+ * sized beforehand by reserve. Each slot carries an atomic state,
+ * which an inserter claims by a compare-and-swap before writing the
+ * item, so that no locks are taken.
+ *
+ * The other operations, including insert, are meant to be called from
+ * one task at a time, and resize the table as needed.
+ */
+template <
+  class Item,
+  class Hash = std::hash<Item>,
+  class Equal = std::equal_to<Item>
+>
+class phash_set {
+public:
+
+  using key_type = Item;
+  using value_type = Item;
+  using hasher = Hash;
+  using key_equal = Equal;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using size_type = sptl::size_type;
+
+private:
+
+  using state_type = char;
+
+  static constexpr
+  state_type empty_slot = 0;
+
+  static constexpr
+  state_type busy_slot = 1;
+
+  static constexpr
+  state_type full_slot = 2;
+
+  static constexpr
+  size_type min_capacity = 16;
+
+  class slot_type {
+  public:
+    std::atomic<state_type> state;
+    value_type item;
+  };
+
+  // invariants: capacity is zero or a power of two, and at least one
+  // slot in the table is empty
+  std::unique_ptr<slot_type[]> slots;
+  size_type capacity = 0;
+
+  // number of items, not counting the ones that were inserted concurrently
+  // since the last call to settle
+  size_type nb = 0;
+  perworker::array<size_type> nb_concurrent;
+  std::atomic<bool> dirty;
+
+  size_type home(const key_type& k) const {
+    hasher h;
+    return (size_type)mix_hash((uint64_t)h(k)) & (capacity - 1);
+  }
+
+  size_type next(size_type i) const {
+    return (i + 1) & (capacity - 1);
+  }
+
+  // waits for a concurrent inserter that has claimed slot i to finish
+  state_type state_of(size_type i) const {
+    state_type s = slots[i].state.load(std::memory_order_acquire);
+    while (s == busy_slot) {
+      s = slots[i].state.load(std::memory_order_acquire);
+    }
+    return s;
+  }
+
+  // returns the position of the item of key k and true, if there is one,
+  // or, otherwise, the position where the probe for k stopped and false
+  std::pair<size_type, bool> probe(const key_type& k) const {
+    key_equal eq;
+    size_type i = home(k);
+    while (true) {
+      state_type s = state_of(i);
+      if (s == empty_slot) {
+        return std::make_pair(i, false);
+      }
+      if (eq(slots[i].item, k)) {
+        return std::make_pair(i, true);
+      }
+      i = next(i);
+    }
+  }
+
+  std::pair<pointer, bool> insert_in_table(const value_type& x) {
+    key_equal eq;
+    size_type i = home(x);
+    while (true) {
+      state_type s = slots[i].state.load(std::memory_order_acquire);
+      if (s == empty_slot) {
+        if (slots[i].state.compare_exchange_strong(s, busy_slot, std::memory_order_acq_rel)) {
+          slots[i].item = x;
+          slots[i].state.store(full_slot, std::memory_order_release);
+          return std::make_pair(&slots[i].item, true);
+        }
+      }
+      if (s == busy_slot) {
+        s = state_of(i);
+      }
+      if (eq(slots[i].item, x)) {
+        return std::make_pair(&slots[i].item, false);
+      }
+      i = next(i);
+    }
+  }
+
+  void settle() {
+    if (! dirty.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto fold = [&] (size_type& c) {
+      nb += c;
+      c = 0;
+    };
+    nb_concurrent.iterate(fold);
+    dirty.store(false, std::memory_order_relaxed);
+  }
+
+  void alloc(size_type n) {
+    capacity = n;
+    slots.reset((n == 0) ? nullptr : new slot_type[n]);
+    slot_type* s = slots.get();
+    parallel_for((size_type)0, n, [s] (size_type i) {
+      s[i].state.store(empty_slot, std::memory_order_relaxed);
+    });
+  }
+
+  // moves the items into a fresh table of n slots
+  void rehash(size_type n) {
+    std::unique_ptr<slot_type[]> old_slots = std::move(slots);
+    size_type old_capacity = capacity;
+    alloc(n);
+    slot_type* s = old_slots.get();
+    parallel_for((size_type)0, old_capacity, [&, s] (size_type i) {
+      if (s[i].state.load(std::memory_order_relaxed) == full_slot) {
+        insert_in_table(s[i].item);
+      }
+    });
+  }
+
+  void init() {
+    nb = 0;
+    nb_concurrent.init(0);
+    dirty.store(false);
+  }
+
+public:
+
+  phash_set() {
+    init();
+  }
+
+  phash_set(const phash_set& other) {
+    init();
+    const_cast<phash_set&>(other).settle();
+    nb = other.nb;
+    alloc(other.capacity);
+    slot_type* s = slots.get();
+    slot_type* t = other.slots.get();
+    parallel_for((size_type)0, capacity, [s, t] (size_type i) {
+      state_type st = t[i].state.load(std::memory_order_relaxed);
+      if (st == full_slot) {
+        s[i].item = t[i].item;
+      }
+      s[i].state.store(st, std::memory_order_relaxed);
+    });
+  }
+
+  phash_set(phash_set&& other)
+  : slots(std::move(other.slots)), capacity(other.capacity) {
+    init();
+    other.settle();
+    nb = other.nb;
+    other.capacity = 0;
+    other.nb = 0;
+  }
+
+  phash_set& operator=(const phash_set& other) {
+    if (&other != this) {
+      phash_set tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  phash_set& operator=(phash_set&& other) {
+    phash_set tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  phash_set(std::initializer_list<value_type> xs) {
+    init();
+    reserve(xs.size());
+    for (auto it = xs.begin(); it != xs.end(); it++) {
+      insert(*it);
+    }
+  }
+
+  template <class Iter>
+  phash_set(Iter lo, Iter hi) {
+    init();
+    reserve(hi - lo);
+    parallel_for(lo, hi, [&] (Iter it) {
+      concurrent_insert(*it);
+    });
+    settle();
+  }
+
+  phash_set(size_type sz, const std::function<value_type(size_type)>& body) {
+    init();
+    reserve(sz);
+    parallel_for((size_type)0, sz, [&] (size_type i) {
+      concurrent_insert(body(i));
+    });
+    settle();
+  }
+
+  size_type size() const {
+    const_cast<phash_set*>(this)->settle();
+    return nb;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /* Makes room for n items in total, so that up to n - size() items can
+   * then be inserted concurrently.
+   */
+  void reserve(size_type n) {
+    size_type target = min_capacity;
+    while (target < 2 * n) {
+      target *= 2;
+    }
+    if (target > capacity) {
+      rehash(target);
+    }
+  }
+
+  // returns a pointer to the item of key k, or nullptr if there is none
+  pointer find(const key_type& k) const {
+    if (capacity == 0) {
+      return nullptr;
+    }
+    auto r = probe(k);
+    return r.second ? &slots[r.first].item : nullptr;
+  }
+
+  size_type count(const key_type& k) const {
+    return (find(k) == nullptr) ? 0 : 1;
+  }
+
+  std::pair<pointer, bool> insert(const value_type& x) {
+    settle();
+    reserve(nb + 1);
+    auto r = insert_in_table(x);
+    if (r.second) {
+      nb++;
+    }
+    return r;
+  }
+
+  /* Same as insert, except that it is safe to call concurrently with
+   * find and other calls to concurrent_insert, but never resizes the
+   * table: the caller must have reserved room for the new items.
+   */
+  std::pair<pointer, bool> concurrent_insert(const value_type& x) {
+    assert(capacity > 0);
+    auto r = insert_in_table(x);
+    if (r.second) {
+      nb_concurrent.mine()++;
+      if (! dirty.load(std::memory_order_relaxed)) {
+        dirty.store(true, std::memory_order_relaxed);
+      }
+    }
+    return r;
+  }
+
+  size_type erase(const key_type& k) {
+    if (capacity == 0) {
+      return 0;
+    }
+    auto r = probe(k);
+    if (! r.second) {
+      return 0;
+    }
+    settle();
+    // backward-shift deletion: pull into the hole every following item
+    // whose probe sequence passes over the hole
+    size_type i = r.first;
+    size_type j = i;
+    while (true) {
+      j = next(j);
+      if (slots[j].state.load(std::memory_order_relaxed) == empty_slot) {
+        break;
+      }
+      size_type h = home(slots[j].item);
+      bool in_place = (i <= j) ? ((i < h) && (h <= j)) : ((i < h) || (h <= j));
+      if (! in_place) {
+        slots[i].item = std::move(slots[j].item);
+        i = j;
+      }
+    }
+    slots[i].state.store(empty_slot, std::memory_order_relaxed);
+    nb--;
+    return 1;
+  }
+
+  void clear() {
+    alloc(0);
+    init();
+  }
+
+  void swap(phash_set& other) {
+    settle();
+    other.settle();
+    slots.swap(other.slots);
+    std::swap(capacity, other.capacity);
+    std::swap(nb, other.nb);
+  }
+
+  template <class Body>
+  void for_each(const Body& body) const {
+    slot_type* s = slots.get();
+    parallel_for((size_type)0, capacity, [&, s] (size_type i) {
+      if (s[i].state.load(std::memory_order_relaxed) == full_slot) {
+        body(s[i].item);
+      }
+    });
+  }
+
+  // returns the items of the set, in no particular order
+  parray<value_type> elements() const {
+    slot_type* s = slots.get();
+    parray<bool> flags(capacity, [s] (size_type i) {
+      return s[i].state.load(std::memory_order_relaxed) == full_slot;
+    });
+    parray<value_type> result;
+    value_type dummy;
+    __priv::pack(flags.cbegin(), s, s + capacity, dummy, [&] (size_type m) {
+      result.reset(m);
+      return result.begin();
+    }, [&] (size_type, const slot_type& x) {
+      return x.item;
+    });
+    return result;
+  }
+
+};
+
+} // end namespace
+
+#endif
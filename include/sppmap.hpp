@@ -57,6 +57,9 @@ public:
   pmap(std::initializer_list<value_type> xs)
   : set(xs) { }
   
+  pmap(pset_type&& set)
+  : set(std::move(set)) { }
+  
   template <class Iter>
   pmap(Iter lo, Iter hi)
   : set(lo, hi) { }
@@ -95,7 +98,29 @@ public:
   }
   
   size_type erase(const key_type& k) {
-    set.erase(std::make_pair(k, mapped_type()));
+    return set.erase(std::make_pair(k, mapped_type()));
+  }
+  
+  template <class Iter>
+  void insert_batch(Iter lo, Iter hi) {
+    set.insert_batch(lo, hi);
+  }
+  
+  // Iter: iterator over keys
+  template <class Iter>
+  size_type erase_batch(Iter lo, Iter hi) {
+    parray<value_type> vals(hi - lo, [&] (size_type i) {
+      return std::make_pair(*(lo + i), mapped_type());
+    });
+    return set.erase_batch(vals.cbegin(), vals.cend());
+  }
+  
+  // Iter: iterator over keys
+  template <class Iter>
+  parray<const_iterator> find_batch(Iter lo, Iter hi) const {
+    return parray<const_iterator>(hi - lo, [&] (size_type i) {
+      return find(*(lo + i));
+    });
   }
   
   mapped_type& operator[] (const key_type& k) {
@@ -106,6 +131,28 @@ public:
     return (*it).second;
   }
   
+  // returns a copy of the entries whose keys are in [lo, hi)
+  pmap range(const key_type& lo, const key_type& hi) const {
+    return pmap(set.range(std::make_pair(lo, mapped_type()),
+                          std::make_pair(hi, mapped_type())));
+  }
+  
+  // returns a copy of the entries that satisfy pred
+  template <class Pred>
+  pmap filter(const Pred& pred) const {
+    return pmap(set.filter(pred));
+  }
+  
+  // replaces, in parallel, each mapped value v by f(v)
+  template <class Fct>
+  void map_values(const Fct& f) {
+    chunked::for_each_segment(set.begin(), set.end(), [&] (pointer lo, pointer hi) {
+      for (pointer p = lo; p != hi; p++) {
+        p->second = f(p->second);
+      }
+    });
+  }
+  
   void merge(pmap& other) {
     set.merge(other.set);
   }
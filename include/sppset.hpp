@@ -1,5 +1,6 @@
 
 #include "sppchunkedseq.hpp"
+#include "spsort.hpp"
 
 #ifndef _SPTL_SPPSET_H_
 #define _SPTL_SPPSET_H_
@@ -26,6 +27,8 @@ namespace {
     optional(const optional& other)
     : item(other.item), no_item(other.no_item) { }
     
+    optional& operator=(const optional& other) = default;
+    
     void swap(self_type& other) {
       std::swap(item, other.item);
       std::swap(no_item, other.no_item);
@@ -107,7 +110,8 @@ template <
   class Item,
   class Compare = std::less<Item>,
   class Alloc = std::allocator<Item>,
-  int chunk_capacity = 8
+  int chunk_capacity = 8,
+  class Cache = pset_cache<Item, sptl::size_type>
 >
 class pset {
 public:
@@ -125,7 +129,7 @@ public:
   
 private:
   
-  using cache_type = pset_cache<value_type, size_type>;
+  using cache_type = Cache;
   using container_type = pasl::data::chunkedseq::bootstrapped::deque<value_type, chunk_capacity, cache_type>;
   using option_type = typename cache_type::measured_type;
   
@@ -190,61 +194,79 @@ private:
     return it;
   }
   
-  static container_type merge_seq(container_type& xs, container_type& ys) {
-    container_type result;
+  /* Walks xs and ys in ascending order of keys, one segment at a time,
+   * and returns the items whose keys are only in xs if keep_xs_only, only
+   * in ys if keep_ys_only and in both if keep_both, in which case the item
+   * of xs is kept. The items are written to the result a chunk at a time,
+   * and the leftover items of either input are moved in bulk. Both inputs
+   * are left empty.
+   */
+  static container_type merge_seq_by(container_type& xs, container_type& ys,
+                                     bool keep_xs_only, bool keep_ys_only, bool keep_both) {
+    using reader_type = chunked::segment_reader<iterator>;
     key_compare compare;
-    long n = xs.size();
-    long m = ys.size();
-    while (true) {
-      if (n < m) {
-        std::swap(n, m);
-        xs.swap(ys);
-      }
-      if (n == 0) {
-        // xs.empty() implies that ys.empty()
-        break;
-      } else if (m == 0) {
-        if (same_key(xs.front(), result.back())) {
-          xs.pop_front();
-          n--;
-        }
-        result.concat(xs);
-        break;
-      } else {
-        value_type x = xs.front();
-        value_type y = ys.front();
+    container_type result;
+    reader_type rx(xs.begin(), xs.end());
+    reader_type ry(ys.begin(), ys.end());
+    {
+      chunked::chunk_writer<container_type> out(result);
+      while ((! rx.empty()) && (! ry.empty())) {
+        const value_type& x = rx.front();
+        const value_type& y = ry.front();
         if (compare(x, y)) {
-          xs.pop_front();
-          result.push_back(x);
-          n--;
+          if (keep_xs_only) {
+            out.push_back(x);
+          }
+          rx.pop_front();
         } else if (compare(y, x)) {
-          ys.pop_front();
-          result.push_back(y);
-          m--;
+          if (keep_ys_only) {
+            out.push_back(y);
+          }
+          ry.pop_front();
         } else {
-          xs.pop_front();
-          n--;
+          if (keep_both) {
+            out.push_back(x);
+          }
+          rx.pop_front();
+          ry.pop_front();
         }
       }
     }
+    container_type rest;
+    if ((! rx.empty()) && keep_xs_only) {
+      xs.split(rx.position(), rest);
+    } else if ((! ry.empty()) && keep_ys_only) {
+      ys.split(ry.position(), rest);
+    }
+    result.concat(rest);
+    xs.clear();
+    ys.clear();
     return result;
   }
   
-  static container_type merge(container_type& xs, container_type& ys) {
+  static container_type merge_seq(container_type& xs, container_type& ys) {
+    return merge_seq_by(xs, ys, true, true, true);
+  }
+  
+  /* On shared keys, keeps the items of xs if xs_wins, or those of ys
+   * otherwise. The recursion splits the larger of the two inputs, so it
+   * may swap them, in which case it flips xs_wins.
+   */
+  static container_type merge(container_type& xs, container_type& ys, bool xs_wins = true) {
     key_compare compare;
     long n = xs.size();
     long m = ys.size();
     container_type result;
     spguard([&] { return n + m; }, [&] {
       if (n < m) {
-        result = merge(ys, xs);
+        result = merge(ys, xs, ! xs_wins);
       } else if (n == 0) {
         result = { };
       } else if (n == 1) {
         if (m == 0) {
           result.push_back(xs.back());
         } else if (same_key(xs.back(), ys.back())) {
-          result.push_back(xs.back());
+          result.push_back(xs_wins ? xs.back() : ys.back());
         } else {
           result.push_back(std::min(xs.back(), ys.back(), compare));
           result.push_back(std::max(xs.back(), ys.back(), compare));
@@ -259,14 +281,14 @@ private:
         }, ys2);
         container_type result2;
         fork2([&] {
-          result = merge(xs, ys);
+          result = merge(xs, ys, xs_wins);
         }, [&] {
-          result2 = merge(xs2, ys2);
+          result2 = merge(xs2, ys2, xs_wins);
         });
         result.concat(result2);
       }
     }, [&] {
-      result = merge_seq(xs, ys);
+      result = xs_wins ? merge_seq(xs, ys) : merge_seq(ys, xs);
     });
     return result;
   }
@@ -276,46 +298,21 @@ private:
   }
   
   static container_type intersect_seq(container_type& xs, container_type& ys) {
-    key_compare compare;
-    container_type result;
-    long n = xs.size();
-    long m = ys.size();
-    while (true) {
-      if ((n == 0) || (m == 0)) {
-        break;
-      }
-      value_type x = xs.front();
-      value_type y = ys.front();
-      if (compare(x, y)) {
-        xs.pop_front();
-        n--;
-      } else if (compare(y, x)) {
-        ys.pop_front();
-        m--;
-      } else { // then, x == y
-        xs.pop_front();
-        n--;
-        ys.pop_front();
-        m--;
-        result.push_back(x);
-      }
-    }
-    xs.clear();
-    ys.clear();
-    return result;
+    return merge_seq_by(xs, ys, false, false, true);
   }
   
-  static container_type intersect(container_type& xs, container_type& ys) {
+  // keeps the items of xs if xs_wins, or those of ys otherwise (see merge)
+  static container_type intersect(container_type& xs, container_type& ys, bool xs_wins = true) {
     long n = xs.size();
     long m = ys.size();
     container_type result;
     spguard([&] { return n + m; }, [&] {
       if (n < m) {
-        result = intersect(ys, xs);
+        result = intersect(ys, xs, ! xs_wins);
       } else if (n == 0) {
         result = { };
       } else if ((n == 1) && (m == 1) && same_key(xs.back(), ys.back())) {
-        result.push_back(xs.back());
+        result.push_back(xs_wins ? xs.back() : ys.back());
       } else if (n == 1) {
         result = { };
       } else {
@@ -328,46 +325,20 @@ private:
         }, ys2);
         container_type result2;
         fork2([&] {
-          result = intersect(xs, ys);
+          result = intersect(xs, ys, xs_wins);
         }, [&] {
-          result2 = intersect(xs2, ys2);
+          result2 = intersect(xs2, ys2, xs_wins);
         });
         result.concat(result2);
       }
     }, [&] {
-      result = intersect_seq(xs, ys);
+      result = xs_wins ? intersect_seq(xs, ys) : intersect_seq(ys, xs);
     });
     return result;
   }
   
   static container_type diff_seq(container_type& xs, container_type& ys) {
-    key_compare compare;
-    container_type result;
-    long n = xs.size();
-    long m = ys.size();
-    while (true) {
-      if ((n == 0) || (m == 0)) {
-        break;
-      }
-      value_type x = xs.front();
-      value_type y = ys.front();
-      if (compare(x, y)) {
-        result.push_back(x);
-        xs.pop_front();
-        n--;
-      } else if (compare(y, x)) {
-        ys.pop_front();
-        m--;
-      } else {
-        xs.pop_front();
-        n--;
-        ys.pop_front();
-        m--;
-      }
-    }
-    ys.clear();
-    result.concat(xs);
-    return result;
+    return merge_seq_by(xs, ys, true, false, false);
   }
   
   // result := xs - ys
@@ -476,6 +447,240 @@ private:
     return result;
   }
   
+  /* Calls body on a piece of seq that holds the items whose keys are in
+   * [lo, hi). The piece is obtained by splitting seq at the positions of
+   * lo and hi, and is joined back afterwards, so the overhead of the
+   * call is logarithmic in the size of the container. The container is
+   * modified in the meantime, hence the method is not const.
+   */
+  template <class Body>
+  void with_range(const key_type& lo, const key_type& hi, const Body& body) {
+    option_type lo_target(lo);
+    option_type hi_target(hi);
+    container_type middle;
+    seq.split([&] (const option_type& key) {
+      return less_than_or_equal(lo_target, key);
+    }, middle);
+    container_type rest;
+    middle.split([&] (const option_type& key) {
+      return less_than_or_equal(hi_target, key);
+    }, rest);
+    body(middle);
+    middle.concat(rest);
+    seq.concat(middle);
+    it = seq.begin();
+  }
+  
+  static iterator first_larger_or_eq(container_type& xs, const key_type& k) {
+    option_type target(k);
+    iterator it = xs.begin();
+    it.search_by([&] (const option_type& key) {
+      return less_than_or_equal(target, key);
+    });
+    return it;
+  }
+  
+  // returns the items of [lo, hi) sorted by key, keeping only the first
+  // of the items that share a key
+  template <class Iter>
+  static parray<value_type> sorted_batch(Iter lo, Iter hi) {
+    key_compare compare;
+    parray<value_type> xs(hi - lo, [&] (size_type i) {
+      return *(lo + i);
+    });
+    sptl::stable_sort(xs.begin(), xs.end(), compare);
+    return filteri(xs.cbegin(), xs.cend(), [&] (size_type i, const value_type& x) {
+      return (i == 0) || (! same_key(xs[i - 1], x));
+    });
+  }
+  
+  /* Applies the sorted batch [lo, hi) to xs: the batch is cut at its
+   * middle key, xs is split at the position of that key, and the two
+   * halves are handled in parallel before being joined back. Small
+   * batches are handed to seq_apply.
+   */
+  template <class Seq_apply>
+  static void apply_batch(container_type& xs, const value_type* lo, const value_type* hi,
+                          const Seq_apply& seq_apply) {
+    size_type m = hi - lo;
+    spguard([&] { return m; }, [&] {
+      if (m <= 1) {
+        seq_apply(xs, lo, hi);
+        return;
+      }
+      const value_type* mid = lo + m / 2;
+      option_type target(*mid);
+      container_type xs2;
+      xs.split([&] (const option_type& key) {
+        return less_than_or_equal(target, key);
+      }, xs2);
+      fork2([&] {
+        apply_batch(xs, lo, mid, seq_apply);
+      }, [&] {
+        apply_batch(xs2, mid, hi, seq_apply);
+      });
+      xs.concat(xs2);
+    }, [&] {
+      seq_apply(xs, lo, hi);
+    });
+  }
+  
+  static void insert_seq(container_type& xs, const value_type* lo, const value_type* hi) {
+    for (const value_type* p = lo; p != hi; p++) {
+      iterator it = first_larger_or_eq(xs, *p);
+      if (it == xs.end()) {
+        xs.push_back(*p);
+      } else if (! same_key(*it, *p)) {
+        xs.insert(it, *p);
+      }
+    }
+  }
+  
+  static void erase_seq(container_type& xs, const value_type* lo, const value_type* hi) {
+    for (const value_type* p = lo; p != hi; p++) {
+      iterator it = first_larger_or_eq(xs, *p);
+      if ((it == xs.end()) || (! same_key(*it, *p))) {
+        continue;
+      }
+      if (it + 1 == xs.end()) {
+        xs.pop_back();
+      } else {
+        xs.erase(it, it + 1);
+      }
+    }
+  }
+  
+  // replaces the items of xs that share a key with an item of the batch
+  static void replace_seq(container_type& xs, const value_type* lo, const value_type* hi) {
+    for (const value_type* p = lo; p != hi; p++) {
+      iterator it = first_larger_or_eq(xs, *p);
+      if (it == xs.end()) {
+        xs.push_back(*p);
+        continue;
+      }
+      if (same_key(*it, *p)) {
+        // erase and insert, rather than assign, to refresh the cached measures
+        xs.erase(it, it + 1);
+        it = first_larger_or_eq(xs, *p);
+      }
+      if (it == xs.end()) {
+        xs.push_back(*p);
+      } else {
+        xs.insert(it, *p);
+      }
+    }
+  }
+  
+  /* Set operations on inputs of very different sizes: when one input
+   * is much smaller than the other, the set operations are driven by
+   * the items of the small input, which are either applied as a batch
+   * to the large input, by splitting it at the keys of the batch (see
+   * apply_batch), or looked up in the large input.
+   * For sizes m <= n, this costs O(m log(n/m + 1)) work for the first
+   * method, and O(m log n) for the second, instead of the O(n + m) of
+   * merging.
+   */
+  
+  static bool much_smaller(size_type m, size_type n) {
+    return m * (size_type)(1 + std::log2(n + 1)) < n;
+  }
+  
+  static parray<value_type> items_of(container_type& xs) {
+    parray<value_type> result;
+    result.reset(xs.size());
+    value_type* dst = result.begin();
+    chunked::for_each_segmenti(xs.begin(), xs.end(), [&] (size_type i, pointer lo, pointer hi) {
+      std::copy(lo, hi, dst + i);
+    });
+    return result;
+  }
+  
+  static void assign_items(container_type& xs, const parray<value_type>& items) {
+    chunked::tabulate_dst(items.size(), xs, [&] (size_type i, reference dst) {
+      dst = items[i];
+    });
+  }
+  
+  /* Returns the items of small whose keys are in large, if keep_found,
+   * or not in large, otherwise. With take_from_large, the items are
+   * taken from large rather than small. Both inputs are left empty.
+   */
+  static container_type lookup_small(container_type& small, container_type& large,
+                                     bool keep_found, bool take_from_large) {
+    parray<value_type> items = items_of(small);
+    size_type m = items.size();
+    parray<bool> flags(m);
+    parallel_for((size_type)0, m, [&] (size_type i) {
+      iterator it = first_larger_or_eq(large, items[i]);
+      bool found = (it != large.end()) && same_key(*it, items[i]);
+      flags[i] = (found == keep_found);
+      if (found && take_from_large) {
+        items[i] = *it;
+      }
+    });
+    parray<value_type> kept = pack(items.cbegin(), items.cend(), flags.cbegin());
+    container_type result;
+    assign_items(result, kept);
+    chunked::clear(small);
+    chunked::clear(large);
+    return result;
+  }
+  
+  // moves the items of small into large; on shared keys, keeps the
+  // items of small if small_wins, or those of large otherwise
+  static container_type merge_small(container_type& small, container_type& large, bool small_wins) {
+    parray<value_type> batch = items_of(small);
+    chunked::clear(small);
+    if (small_wins) {
+      apply_batch(large, batch.cbegin(), batch.cend(), replace_seq);
+    } else {
+      apply_batch(large, batch.cbegin(), batch.cend(), insert_seq);
+    }
+    container_type result;
+    result.swap(large);
+    return result;
+  }
+  
+  // on shared keys, keeps the items of xs
+  static container_type set_union(container_type& xs, container_type& ys) {
+    size_type n = xs.size();
+    size_type m = ys.size();
+    if (much_smaller(m, n)) {
+      return merge_small(ys, xs, false);
+    } else if (much_smaller(n, m)) {
+      return merge_small(xs, ys, true);
+    }
+    return merge(xs, ys);
+  }
+  
+  // keeps the items of xs
+  static container_type set_intersection(container_type& xs, container_type& ys) {
+    size_type n = xs.size();
+    size_type m = ys.size();
+    if (much_smaller(m, n)) {
+      return lookup_small(ys, xs, true, true);
+    } else if (much_smaller(n, m)) {
+      return lookup_small(xs, ys, true, false);
+    }
+    return intersect(xs, ys);
+  }
+  
+  static container_type set_difference(container_type& xs, container_type& ys) {
+    size_type n = xs.size();
+    size_type m = ys.size();
+    if (much_smaller(m, n)) {
+      parray<value_type> batch = items_of(ys);
+      chunked::clear(ys);
+      apply_batch(xs, batch.cbegin(), batch.cend(), erase_seq);
+      container_type result;
+      result.swap(xs);
+      return result;
+    } else if (much_smaller(n, m)) {
+      return lookup_small(xs, ys, false, false);
+    }
+    return diff(xs, ys);
+  }
+  
   void init() {
     it = seq.begin();
   }
@@ -501,7 +706,10 @@ public:
   }
   
   pset(pset&& other)
-  : seq(std::move(other.seq)) { }
+  : seq(std::move(other.seq)) {
+    init();
+    other.init();
+  }
   
   pset(std::initializer_list<value_type> xs)
   : seq(xs) {
@@ -510,7 +718,9 @@ public:
   
   template <class Iter>
   pset(Iter lo, Iter hi) {
-    chunked::copy_dst(lo, hi, seq);
+    chunked::tabulate_dst(hi - lo, seq, [&] (size_type i, reference dst) {
+      dst = *(lo + i);
+    });
     uniqify();
   }
   
@@ -540,12 +750,12 @@ public:
   
   iterator find(const key_type& k) {
     iterator it = first_larger_or_eq(k);
-    return (same_key(*it, k)) ? it : seq.end();
+    return ((it != seq.end()) && same_key(*it, k)) ? it : seq.end();
   }
   
   const_iterator find(const key_type& k) const {
     const_iterator it = first_larger_or_eq(k);
-    return (same_key(*it, k)) ? it : seq.end();
+    return ((it != seq.cend()) && same_key(*it, k)) ? it : seq.cend();
   }
   
   std::pair<iterator,bool> insert(const value_type& val) {
@@ -581,6 +791,72 @@ public:
     return nb - seq.size();
   }
   
+  /* Returns the cached measure of the items whose keys are in [lo, hi).
+   * The container is split around the range and joined back, so the cost
+   * is logarithmic in the size of the container. Because of the split,
+   * the call must not overlap with any other call on the same container,
+   * not even another call to measure_range.
+   */
+  option_type measure_range(const key_type& lo, const key_type& hi) {
+    option_type result;
+    with_range(lo, hi, [&] (container_type& middle) {
+      result = middle.get_cached();
+    });
+    return result;
+  }
+  
+  // returns a copy of the items whose keys are in [lo, hi); the
+  // container is only read, so that concurrent calls are safe
+  pset range(const key_type& lo, const key_type& hi) const {
+    pset result;
+    const_iterator first = first_larger_or_eq(lo);
+    const_iterator last = first_larger_or_eq(hi);
+    if (first < last) {
+      chunked::copy_dst(first, last, result.seq);
+    }
+    result.init();
+    return result;
+  }
+  
+  // returns a copy of the items that satisfy pred
+  template <class Pred>
+  pset filter(const Pred& pred) const {
+    pset result;
+    chunked::filter_dst(seq.cbegin(), seq.cend(), result.seq, pred);
+    result.init();
+    return result;
+  }
+  
+  /* Batched versions of insert, erase and find. The first two sort
+   * the batch in parallel and then apply it to disjoint pieces of the
+   * container in parallel. When the batch holds several items of the
+   * same key, insert_batch keeps the first one.
+   */
+  
+  template <class Iter>
+  void insert_batch(Iter lo, Iter hi) {
+    parray<value_type> batch = sorted_batch(lo, hi);
+    apply_batch(seq, batch.cbegin(), batch.cend(), insert_seq);
+    init();
+  }
+  
+  template <class Iter>
+  size_type erase_batch(Iter lo, Iter hi) {
+    size_type nb = seq.size();
+    parray<value_type> batch = sorted_batch(lo, hi);
+    apply_batch(seq, batch.cbegin(), batch.cend(), erase_seq);
+    init();
+    return nb - seq.size();
+  }
+  
+  // returns, for each key of [lo, hi), the position of its item, or cend()
+  template <class Iter>
+  parray<const_iterator> find_batch(Iter lo, Iter hi) const {
+    return parray<const_iterator>(hi - lo, [&] (size_type i) {
+      return find(*(lo + i));
+    });
+  }
+  
   iterator begin() const {
     return seq.begin();
   }
@@ -602,24 +878,40 @@ public:
   }
   
   void merge(pset& other) {
-    seq = merge(seq, other.seq);
+    seq = set_union(seq, other.seq);
     other.clear();
+    init();
+    other.init();
   }
   
   void intersect(pset& other) {
-    seq = intersect(seq, other.seq);
+    seq = set_intersection(seq, other.seq);
     other.clear();
+    init();
+    other.init();
   }
   
   void diff(pset& other) {
-    seq = diff(seq, other.seq);
+    seq = set_difference(seq, other.seq);
     other.clear();
+    init();
+    other.init();
   }
   
   void clear() {
     chunked::clear(seq);
   }
   
+  // replaces the items by the n items written by body_idx_dst(i, dst),
+  // for i in [0, n), which must be sorted and distinct; unlike the
+  // constructors, does not sort
+  template <class Body_idx_dst>
+  void tabulate_sorted(size_type n, const Body_idx_dst& body_idx_dst) {
+    chunked::clear(seq);
+    chunked::tabulate_dst(n, seq, body_idx_dst);
+    init();
+  }
+  
 };
   
 } // end namespace
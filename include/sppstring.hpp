@@ -1,5 +1,11 @@
 
+#include <atomic>
+#include <mutex>
+
 #include "spparray.hpp"
+#include "sppchunkedseq.hpp"
+#include "spdataparallel.hpp"
+#include "spcharkernels.hpp"
 
 #ifndef _SPTL_PSTRING_H_
 #define _SPTL_PSTRING_H_
@@ -10,6 +16,7 @@ class pstring {
 private:
   
   using parray_type = parray<char>;
+  using rope_type = pchunkedseq<char>;
   
 public:
   
@@ -23,15 +30,71 @@ public:
   using const_pointer = const value_type*;
   using iterator = typename parray_type::iterator;
   using const_iterator = typename parray_type::const_iterator;
+  // the offset and length of a token
+  using token_type = std::pair<size_type, size_type>;
+  
+  static constexpr
+  size_type npos = (size_type)-1L;
   
-  parray_type chars;
+  mutable parray_type chars;
   
 private:
   
+  /* A string is represented either flat, by the characters in chars
+   * followed by a null character, or as a rope, by the characters in
+   * rope, in which case chars holds just the null character. The rope
+   * supports concatenation and splitting in logarithmic time.
+   *
+   * The const operations that need contiguous characters do not change
+   * the representation: on a rope, they build a flat copy of the rope
+   * in chars, once, under flat_copy_mutex, so that they can run
+   * concurrently. The copy is dropped by the next operation that
+   * changes the rope.
+   */
+  rope_type rope;
+  bool in_rope = false;
+  mutable std::atomic<bool> has_flat_copy{false};
+  mutable std::mutex flat_copy_mutex;
+  
   void make_null_terminated() {
     chars[size()] = '\0';
   }
   
+  void set_empty_flat() const {
+    parray_type tmp(1, '\0');
+    chars.swap(tmp);
+  }
+  
+  // makes chars hold the characters of the string; safe to call
+  // concurrently
+  void make_flat_copy() const {
+    if ((! in_rope) || has_flat_copy.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(flat_copy_mutex);
+    if (has_flat_copy.load(std::memory_order_relaxed)) {
+      return;
+    }
+    size_type n = rope.seq.size();
+    parray_type tmp;
+    tmp.reset(n + 1);
+    chunked::for_each_segmenti(rope.seq.cbegin(), rope.seq.cend(),
+                               [&] (size_type i, const char* lo, const char* hi) {
+      std::copy(lo, hi, tmp.begin() + i);
+    });
+    tmp[n] = '\0';
+    chars.swap(tmp);
+    has_flat_copy.store(true, std::memory_order_release);
+  }
+  
+  // to be called before changing the rope
+  void drop_flat_copy() {
+    if (has_flat_copy.load(std::memory_order_relaxed)) {
+      set_empty_flat();
+      has_flat_copy.store(false, std::memory_order_relaxed);
+    }
+  }
+  
   void init() {
     make_null_terminated();
   }
@@ -40,6 +103,41 @@ private:
     assert(i < size());
   }
   
+  static constexpr
+  size_type find_block_size = 1 << 12;
+  
+  // returns the smallest position in [lo, hi) that matches, or npos if
+  // there is none, where match_rng(lo, hi) returns the first matching
+  // position in [lo, hi), or npos; the positions are searched in blocks
+  // of doubling size, each in parallel, so that the work is
+  // proportional to the position of the first match
+  template <class Match_rng>
+  static size_type find_first(size_type lo, size_type hi, const Match_rng& match_rng) {
+    using input_type = level4::tabulate_input;
+    auto combine = [&] (size_type x, size_type y) {
+      return std::min(x, y);
+    };
+    using output_type = level3::cell_output<size_type, decltype(combine)>;
+    size_type id = npos;
+    output_type out(id, combine);
+    auto convert_reduce = [&] (input_type& in, size_type& dst) {
+      dst = match_rng(in.lo, in.hi);
+    };
+    size_type b = find_block_size;
+    while (lo < hi) {
+      size_type mid = lo + std::min(b, hi - lo);
+      input_type in(lo, mid);
+      size_type result = id;
+      level4::reduce(in, out, id, result, convert_reduce, convert_reduce);
+      if (result != npos) {
+        return result;
+      }
+      lo = mid;
+      b *= 2;
+    }
+    return npos;
+  }
+  
 public:
   
   pstring(size_type sz = 0)
@@ -70,13 +168,24 @@ public:
   pstring(size_type sz,
           const std::function<size_type(size_type)>& body_comp,
           const std::function<value_type(size_type)>& body) {
-    assert(false);
+    parray<size_type> w = sums(sz, body_comp);
+    chars.reset(sz + 1);
+    parallel_for(size_type(0), sz, [&] (size_type lo, size_type hi) {
+      return w[hi] - w[lo];
+    }, [&] (size_type i) {
+      chars[i] = body(i);
+    });
+    make_null_terminated();
   }
   
   pstring(size_type sz,
          const std::function<size_type(size_type,size_type)>& body_comp_rng,
          const std::function<value_type(size_type)>& body) {
-    assert(false);
+    chars.reset(sz + 1);
+    parallel_for(size_type(0), sz, body_comp_rng, [&] (size_type i) {
+      chars[i] = body(i);
+    });
+    make_null_terminated();
   }
   
   pstring(std::initializer_list<value_type> xs)
@@ -89,35 +198,60 @@ public:
   }
   
   pstring(const pstring& other)
-  : chars(other.chars) { }
+  : in_rope(other.in_rope) {
+    if (in_rope) {
+      // reads only the rope of other, which may be building its flat copy
+      set_empty_flat();
+      chunked::copy_dst(other.rope.seq.cbegin(), other.rope.seq.cend(), rope.seq);
+    } else {
+      chars = other.chars;
+    }
+  }
+  
+  pstring(pstring&& other)
+  : pstring() {
+    swap(other);
+  }
   
   pstring(iterator lo, iterator hi) {
     size_type n = hi - lo;
-    chars.resize(n + 1);
-    copy(lo, hi, begin());
+    chars.reset(n + 1);
+    sptl::copy(lo, hi, chars.begin());
+    make_null_terminated();
   }
   
   pstring& operator=(const pstring& other) {
-    chars = other.chars;
+    pstring tmp(other);
+    swap(tmp);
     return *this;
   }
   
   pstring& operator=(pstring&& other) {
-    chars = std::move(other.chars);
+    swap(other);
     return *this;
   }
   
   value_type& operator[](size_type i) {
     check(i);
+    if (in_rope) {
+      drop_flat_copy();
+      return *(rope.seq.begin() + i);
+    }
     return chars[i];
   }
   
   const value_type& operator[](size_type i) const {
     check(i);
+    if (in_rope) {
+      return *(rope.seq.cbegin() + i);
+    }
     return chars[i];
   }
   
   size_type size() const {
+    if (in_rope) {
+      return rope.seq.size();
+    }
     return chars.size() - 1;
   }
   
@@ -127,9 +261,44 @@ public:
   
   void swap(pstring& other) {
     chars.swap(other.chars);
+    rope.seq.swap(other.rope.seq);
+    std::swap(in_rope, other.in_rope);
+    bool b = has_flat_copy.load(std::memory_order_relaxed);
+    has_flat_copy.store(other.has_flat_copy.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    other.has_flat_copy.store(b, std::memory_order_relaxed);
+  }
+  
+  bool is_rope() const {
+    return in_rope;
+  }
+  
+  // switches to the rope representation; linear work, logarithmic span
+  void to_rope() {
+    if (in_rope) {
+      drop_flat_copy();
+      return;
+    }
+    chunked::tabulate_dst(size(), rope.seq, [&] (size_type i, value_type& dst) {
+      dst = chars[i];
+    });
+    set_empty_flat();
+    in_rope = true;
+  }
+  
+  // switches to the flat representation; linear work, logarithmic span
+  void flatten() {
+    if (! in_rope) {
+      return;
+    }
+    make_flat_copy();
+    chunked::clear(rope.seq);
+    in_rope = false;
+    has_flat_copy.store(false, std::memory_order_relaxed);
   }
   
   void resize(size_type n, const value_type& val) {
+    flatten();
     chars.resize(n+1, val);
     make_null_terminated();
   }
@@ -140,41 +309,97 @@ public:
   }
   
   void clear() {
-    resize(0);
+    chunked::clear(rope.seq);
+    set_empty_flat();
+    in_rope = false;
+    has_flat_copy.store(false, std::memory_order_relaxed);
+  }
+  
+  // the characters can be written through the iterators, so the
+  // non-const versions flatten the string
+  iterator begin() {
+    flatten();
+    return chars.begin();
   }
   
   iterator begin() const {
+    make_flat_copy();
     return chars.begin();
   }
   
   const_iterator cbegin() const {
+    make_flat_copy();
     return chars.cbegin();
   }
   
+  iterator end() {
+    flatten();
+    return chars.end();
+  }
+  
   iterator end() const {
+    make_flat_copy();
     return chars.end();
   }
   
   const_iterator cend() const {
+    make_flat_copy();
     return chars.cend();
   }
   
-  pstring& operator+=(const pstring& str) {
-    size_type n1 = size();
-    size_type n2 = str.size();
-    size_type n = n1 + n2;
-    parray_type chars2;
-    chars2.swap(chars);
-    chars.tabulate(n + 1, [&] (size_type i) {
-      if (i < n1) {
-        return chars2[i];
-      } else if (i == n) {
-        return '\0';
-      } else {
-        i -= n1;
-        return str[i];
+  // moves the characters of other to the end of this string, leaving
+  // other empty; logarithmic time
+  void concat(pstring& other) {
+    to_rope();
+    other.to_rope();
+    rope.seq.concat(other.rope.seq);
+  }
+  
+  // moves the characters from position i on to other, which must be
+  // empty; logarithmic time
+  void split(size_type i, pstring& other) {
+    assert(other.size() == 0);
+    assert(i <= size());
+    to_rope();
+    other.to_rope();
+    rope.seq.split(i, other.rope.seq);
+  }
+  
+  // returns the string made of the (at most) len characters starting at
+  // position pos; logarithmic time, plus the time to copy the result
+  pstring substr(size_type pos, size_type len) const {
+    size_type n = size();
+    pos = std::min(pos, n);
+    len = std::min(len, n - pos);
+    pstring result;
+    if (in_rope) {
+      if (len > 0) {
+        auto lo = rope.seq.cbegin() + pos;
+        chunked::copy_dst(lo, lo + len, result.rope.seq);
       }
-    });
+      result.in_rope = true;
+    } else {
+      result.chars.reset(len + 1);
+      sptl::copy(chars.cbegin() + pos, chars.cbegin() + pos + len, result.chars.begin());
+      result.make_null_terminated();
+    }
+    return result;
+  }
+  
+  pstring& operator+=(const pstring& str) {
+    if (&str == this) {
+      // to_rope would drop the characters before they are appended
+      pstring tmp(str);
+      return *this += tmp;
+    }
+    size_type n = str.size();
+    if (! str.in_rope && n <= rope.seq.chunk_capacity) {
+      to_rope();
+      rope.seq.pushn_back(str.chars.cbegin(), n);
+    } else {
+      pstring tmp(str);
+      concat(tmp);
+    }
     return *this;
   }
   
@@ -184,10 +409,108 @@ public:
     return result;
   }
   
-  const char* c_str() {
+  const char* c_str() const {
     return cbegin();
   }
   
+  // returns the position of the first occurrence of c at or after pos,
+  // or npos if there is none
+  size_type find(char c, size_type pos = 0) const {
+    const char* s = cbegin();
+    return find_first(pos, size(), [&] (size_type lo, size_type hi) {
+      const char* p = simd::find_char(s + lo, s + hi, c);
+      return (p == s + hi) ? npos : p - s;
+    });
+  }
+  
+  // returns the position of the first occurrence of str at or after
+  // pos, or npos if there is none
+  size_type find(const pstring& str, size_type pos = 0) const {
+    size_type n = size();
+    size_type m = str.size();
+    if (m > n) {
+      return npos;
+    }
+    const char* s = cbegin();
+    const char* t = str.cbegin();
+    if (m == 0) {
+      return (pos <= n) ? pos : npos;
+    }
+    return find_first(pos, n - m + 1, [&] (size_type lo, size_type hi) {
+      for (const char* p = s + lo; ; p++) {
+        p = simd::find_char(p, s + hi, t[0]);
+        if (p == s + hi) {
+          return npos;
+        }
+        if (memcmp(p, t, m) == 0) {
+          return (size_type)(p - s);
+        }
+      }
+    });
+  }
+  
+  size_type count(char c) const {
+    return level2::reduce(cbegin(), cbegin() + size(), (size_type)0,
+                          [&] (size_type x, size_type y) {
+                            return x + y;
+                          },
+                          [&] (size_type, const char& x) {
+                            return (x == c) ? 1 : 0;
+                          }, [&] (const char* lo, const char* hi) {
+                            return simd::count_char(lo, hi, c);
+                          });
+  }
+  
+  template <class Pred>
+  size_type count_if(const Pred& pred) const {
+    return level2::reduce(cbegin(), cbegin() + size(), (size_type)0,
+                          [&] (size_type x, size_type y) {
+                            return x + y;
+                          },
+                          [&] (size_type, const char& c) {
+                            return pred(c) ? 1 : 0;
+                          }, [&] (const char* lo, const char* hi) {
+                            size_type r = 0;
+                            for (const char* p = lo; p != hi; p++) {
+                              r += pred(*p) ? 1 : 0;
+                            }
+                            return r;
+                          });
+  }
+  
+  // returns, in order, the maximal nonempty runs of characters that do
+  // not belong to delims
+  parray<token_type> split(const char* delims) const {
+    int nb_delims = (int)strlen(delims);
+    size_type n = size();
+    const char* s = cbegin();
+    parray<bool> is_delim;
+    is_delim.reset(n);
+    parallel_for((size_type)0, n, [&] (size_type lo, size_type hi) {
+      return hi - lo;
+    }, [&] (size_type i) {
+      is_delim[i] = memchr(delims, s[i], nb_delims) != nullptr;
+    }, [&] (size_type lo, size_type hi) {
+      simd::mark_any_of(s + lo, s + hi, delims, nb_delims, is_delim.begin() + lo);
+    });
+    auto in_token = [&] (size_type i) {
+      return i < n && ! is_delim[i];
+    };
+    // a token starts or ends at position i whenever in_token(i) differs
+    // from in_token(i-1), so that boundaries alternate between starts
+    // and ends
+    parray<bool> boundaries(n + 1, [&] (size_type i) {
+      bool prev = i > 0 && in_token(i - 1);
+      return in_token(i) != prev;
+    });
+    parray<size_type> offsets = pack_index(boundaries.cbegin(), boundaries.cend());
+    return parray<token_type>(offsets.size() / 2, [&] (size_type i) {
+      size_type lo = offsets[2 * i];
+      size_type hi = offsets[2 * i + 1];
+      return token_type(lo, hi - lo);
+    });
+  }
+  
 };
   
 } // end namespace
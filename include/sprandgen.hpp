@@ -1,4 +1,8 @@
 
+#include <array>
+#include <cmath>
+#include <stdint.h>
+
 #include "sppchunkedseq.hpp"
 
 #ifndef _SPTL_RANDGEN_H_
@@ -44,6 +48,237 @@ T hash(int i) {
   }
 }
   
+// the finalizer of splitmix64: a bijective mixing of 64-bit integers
+static inline
+uint64_t hash64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+/*---------------------------------------------------------------------*/
+/* Counter-based random number generation */
+
+/* The Philox4x32-10 generator of Salmon et al. (SC'11), which maps a
+ * 128-bit counter and a 64-bit key (the seed) to 128 random bits. Since
+ * the i-th block of random bits depends only on the seed and on i,
+ * random arrays can be filled in parallel with the same contents at
+ * any number of workers.
+ */
+class philox4x32 {
+public:
+  
+  using block_type = std::array<uint32_t, 4>;
+  
+  static constexpr
+  int nb_rounds = 10;
+  
+  // number of blocks generated at once by generate, whose rounds are
+  // computed lane by lane so that the compiler can vectorize them
+  static constexpr
+  int nb_lanes = 8;
+  
+private:
+  
+  static constexpr
+  uint32_t m0 = 0xD2511F53;
+  
+  static constexpr
+  uint32_t m1 = 0xCD9E8D57;
+  
+  static constexpr
+  uint32_t w0 = 0x9E3779B9;
+  
+  static constexpr
+  uint32_t w1 = 0xBB67AE85;
+  
+  uint32_t key0;
+  
+  uint32_t key1;
+  
+public:
+  
+  philox4x32(uint64_t seed)
+  : key0((uint32_t)seed), key1((uint32_t)(seed >> 32)) { }
+  
+  block_type operator()(block_type ctr) const {
+    uint32_t k0 = key0;
+    uint32_t k1 = key1;
+    for (int r = 0; r < nb_rounds; r++) {
+      uint64_t p0 = (uint64_t)m0 * ctr[0];
+      uint64_t p1 = (uint64_t)m1 * ctr[2];
+      ctr = {{ (uint32_t)(p1 >> 32) ^ ctr[1] ^ k0, (uint32_t)p1,
+               (uint32_t)(p0 >> 32) ^ ctr[3] ^ k1, (uint32_t)p0 }};
+      k0 += w0;
+      k1 += w1;
+    }
+    return ctr;
+  }
+  
+  // the block of counter i
+  block_type operator()(uint64_t i) const {
+    return (*this)(block_type {{ (uint32_t)i, (uint32_t)(i >> 32), 0, 0 }});
+  }
+  
+  // writes to dst the blocks of the counters lo, ..., lo+n-1, in order,
+  // as 4*n words
+  void generate(uint64_t lo, size_type n, uint32_t* dst) const {
+    size_type i = 0;
+    for (; i + nb_lanes <= n; i += nb_lanes) {
+      uint32_t c0[nb_lanes], c1[nb_lanes], c2[nb_lanes], c3[nb_lanes];
+      for (int l = 0; l < nb_lanes; l++) {
+        uint64_t ctr = lo + i + l;
+        c0[l] = (uint32_t)ctr;
+        c1[l] = (uint32_t)(ctr >> 32);
+        c2[l] = 0;
+        c3[l] = 0;
+      }
+      uint32_t k0 = key0;
+      uint32_t k1 = key1;
+      for (int r = 0; r < nb_rounds; r++) {
+        for (int l = 0; l < nb_lanes; l++) {
+          uint64_t p0 = (uint64_t)m0 * c0[l];
+          uint64_t p1 = (uint64_t)m1 * c2[l];
+          c0[l] = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+          c2[l] = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+          c1[l] = (uint32_t)p1;
+          c3[l] = (uint32_t)p0;
+        }
+        k0 += w0;
+        k1 += w1;
+      }
+      for (int l = 0; l < nb_lanes; l++) {
+        uint32_t* d = dst + 4 * (i + l);
+        d[0] = c0[l];
+        d[1] = c1[l];
+        d[2] = c2[l];
+        d[3] = c3[l];
+      }
+    }
+    for (; i < n; i++) {
+      block_type b = (*this)(lo + i);
+      std::copy(b.begin(), b.end(), dst + 4 * i);
+    }
+  }
+  
+};
+
+namespace __priv {
+
+static constexpr
+size_type random_block_size = 1 << 10;
+
+/* Returns the array of n items where, for each block of random bits k,
+ * the items k*items_per_block, ..., (k+1)*items_per_block-1 are
+ * computed by convert(words, dst, m), which writes the first m of
+ * these items to dst, given the 4 words of block k.
+ */
+template <class Item, class Convert>
+parray<Item> random_tabulate(size_type n, uint64_t seed, size_type items_per_block,
+                             const Convert& convert) {
+  philox4x32 gen(seed);
+  size_type nb_blocks = (n + items_per_block - 1) / items_per_block;
+  size_type nb_leaves = (nb_blocks + random_block_size - 1) / random_block_size;
+  parray<Item> result;
+  result.reset(n);
+  Item* items = result.begin();
+  parallel_for((size_type)0, nb_leaves, [&] (size_type lo, size_type hi) {
+    return (hi - lo) * random_block_size;
+  }, [&] (size_type l) {
+    size_type lo = l * random_block_size;
+    size_type m = std::min(nb_blocks, lo + random_block_size) - lo;
+    uint32_t words[4 * random_block_size];
+    gen.generate(lo, m, words);
+    for (size_type k = 0; k < m; k++) {
+      size_type i = (lo + k) * items_per_block;
+      convert(words + 4 * k, items + i, std::min(items_per_block, n - i));
+    }
+  });
+  return result;
+}
+
+static inline
+uint64_t join_words(const uint32_t* w) {
+  return ((uint64_t)w[1] << 32) | w[0];
+}
+
+// a double uniformly distributed in [0, 1), with 53 random bits
+static inline
+double to_unit_double(uint64_t x) {
+  return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// a double uniformly distributed in (0, 1]
+static inline
+double to_positive_unit_double(uint64_t x) {
+  return ((x >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+} // end namespace
+
+// returns n 64-bit words of random bits
+inline
+parray<uint64_t> random_bits(size_type n, uint64_t seed) {
+  return __priv::random_tabulate<uint64_t>(n, seed, 2, [&] (const uint32_t* w, uint64_t* dst, size_type m) {
+    for (size_type j = 0; j < m; j++) {
+      dst[j] = __priv::join_words(w + 2 * j);
+    }
+  });
+}
+
+// returns n doubles uniformly distributed in [lo, hi)
+inline
+parray<double> random_uniform(size_type n, uint64_t seed, double lo = 0.0, double hi = 1.0) {
+  return __priv::random_tabulate<double>(n, seed, 2, [&] (const uint32_t* w, double* dst, size_type m) {
+    for (size_type j = 0; j < m; j++) {
+      dst[j] = lo + (hi - lo) * __priv::to_unit_double(__priv::join_words(w + 2 * j));
+    }
+  });
+}
+
+// returns n doubles normally distributed with the given mean and
+// standard deviation, by the Box-Muller transform
+inline
+parray<double> random_normal(size_type n, uint64_t seed, double mean = 0.0, double stddev = 1.0) {
+  return __priv::random_tabulate<double>(n, seed, 2, [&] (const uint32_t* w, double* dst, size_type m) {
+    double u = __priv::to_positive_unit_double(__priv::join_words(w));
+    double v = __priv::to_unit_double(__priv::join_words(w + 2));
+    double r = stddev * std::sqrt(-2.0 * std::log(u));
+    double theta = 2.0 * M_PI * v;
+    dst[0] = mean + r * std::cos(theta);
+    if (m > 1) {
+      dst[1] = mean + r * std::sin(theta);
+    }
+  });
+}
+
+// returns n doubles exponentially distributed with the given rate
+inline
+parray<double> random_exponential(size_type n, uint64_t seed, double rate = 1.0) {
+  return __priv::random_tabulate<double>(n, seed, 2, [&] (const uint32_t* w, double* dst, size_type m) {
+    for (size_type j = 0; j < m; j++) {
+      dst[j] = -std::log(__priv::to_positive_unit_double(__priv::join_words(w + 2 * j))) / rate;
+    }
+  });
+}
+
+// returns n integers uniformly distributed in [lo, hi)
+template <class Integ>
+parray<Integ> random_integers(size_type n, uint64_t seed, Integ lo, Integ hi) {
+  uint64_t range = (uint64_t)(hi - lo);
+  return __priv::random_tabulate<Integ>(n, seed, 2, [&] (const uint32_t* w, Integ* dst, size_type m) {
+    for (size_type j = 0; j < m; j++) {
+      // the high 64 bits of the product of the random word and the
+      // range, which is in [0, range) and nearly unbiased
+      uint64_t x = __priv::join_words(w + 2 * j);
+      dst[j] = lo + (Integ)(((unsigned __int128)x * range) >> 64);
+    }
+  });
+}
+
 /*---------------------------------------------------------------------*/
 /* General-purpose container generators */
   
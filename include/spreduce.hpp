@@ -422,6 +422,10 @@ public:
     return seq.size() >= 2;
   }
   
+  size_type size() const {
+    return seq.size();
+  }
+  
   void split(chunkedseq_input& dst) {
     size_type n = seq.size() / 2;
     seq.split(seq.begin() + n, dst.seq);
@@ -0,0 +1,301 @@
+
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+#include "spio.hpp"
+#include "sppset.hpp"
+#include "sppmap.hpp"
+
+#ifndef _SPTL_SERIALIZE_H_
+#define _SPTL_SERIALIZE_H_
+
+namespace sptl {
+
+/*---------------------------------------------------------------------*/
+/* Encodings of items */
+
+/* The encoding of the items of type Item is given by a class that
+ * provides:
+ *   - is_raw, which is true if the encoding is the memory
+ *     representation of the item
+ *   - size, the number of bytes of the encoding of one item
+ *   - write(x, dst), which writes the encoding of x at dst
+ *   - read(src, dst), which reads into dst the encoding at src
+ * Encodings are provided for the trivially copyable types and for the
+ * pairs of encodable types.
+ */
+template <class Item, class Enable = void>
+class serial_traits;
+
+template <class Item>
+class serial_traits<Item, typename std::enable_if<std::is_trivially_copyable<Item>::value>::type> {
+public:
+
+  static constexpr
+  bool is_raw = true;
+
+  static constexpr
+  size_type size = sizeof(Item);
+
+  static void write(const Item& x, char* dst) {
+    memcpy(dst, &x, sizeof(Item));
+  }
+
+  static void read(const char* src, Item& dst) {
+    memcpy(&dst, src, sizeof(Item));
+  }
+
+};
+
+template <class Fst, class Snd>
+class serial_traits<std::pair<Fst, Snd>,
+                    typename std::enable_if<! std::is_trivially_copyable<std::pair<Fst, Snd>>::value>::type> {
+public:
+
+  using fst_traits = serial_traits<Fst>;
+  using snd_traits = serial_traits<Snd>;
+
+  static constexpr
+  bool is_raw = false;
+
+  static constexpr
+  size_type size = fst_traits::size + snd_traits::size;
+
+  static void write(const std::pair<Fst, Snd>& x, char* dst) {
+    fst_traits::write(x.first, dst);
+    snd_traits::write(x.second, dst + fst_traits::size);
+  }
+
+  static void read(const char* src, std::pair<Fst, Snd>& dst) {
+    fst_traits::read(src, dst.first);
+    snd_traits::read(src + fst_traits::size, dst.second);
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Binary format */
+
+/* A serialized container is a header, padded to header_size bytes so
+ * that the items that follow it are aligned, followed by the encodings
+ * of the items, in order.
+ */
+
+namespace __priv {
+
+static constexpr
+uint32_t serial_magic = 0x4c545053; // "SPTL"
+
+static constexpr
+uint32_t serial_version = 1;
+
+static constexpr
+size_type serial_header_size = 64;
+
+static constexpr
+size_type serial_block_size = 1 << 16;
+
+using serial_kind = enum {
+  serial_parray = 1,
+  serial_pchunkedseq = 2,
+  serial_pset = 3,
+  serial_pmap = 4
+};
+
+class serial_header {
+public:
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t kind;
+  uint32_t item_size;
+  uint64_t nb_items;
+
+};
+
+/* Writes a container of n items to the file at path. The items are
+ * given by for_each_segment(visit), which calls visit(i, lo, hi) on
+ * disjoint segments [lo, hi) of items, possibly in parallel, where i is
+ * the position of *lo in the container. Each segment is written at its
+ * own position in the file.
+ */
+template <class Item, class For_each_segment>
+void serialize(const std::string& path, serial_kind kind, size_type n,
+               const For_each_segment& for_each_segment) {
+  using traits = serial_traits<Item>;
+  int fd = open_for_writing(path);
+  char header[serial_header_size];
+  memset(header, 0, serial_header_size);
+  serial_header h = { serial_magic, serial_version, (uint32_t)kind,
+                      (uint32_t)traits::size, (uint64_t)n };
+  memcpy(header, &h, sizeof(h));
+  pwrite_all(fd, header, serial_header_size, 0);
+  for_each_segment([&] (size_type i, const Item* lo, const Item* hi) {
+    off_t offset = serial_header_size + i * traits::size;
+    size_type m = hi - lo;
+    if (traits::is_raw) {
+      pwrite_all(fd, (const char*)lo, m * traits::size, offset);
+    } else {
+      std::vector<char> buf(m * traits::size);
+      for (size_type k = 0; k < m; k++) {
+        traits::write(lo[k], buf.data() + k * traits::size);
+      }
+      pwrite_all(fd, buf.data(), buf.size(), offset);
+    }
+  });
+  close_after_writing(fd, path);
+}
+
+template <class Item>
+void for_each_block(const Item* lo, size_type n, size_type block_size,
+                    const std::function<void(size_type, const Item*, const Item*)>& visit) {
+  size_type nb_blocks = (n + block_size - 1) / block_size;
+  parallel_for((size_type)0, nb_blocks, [&] (size_type lo_b, size_type hi_b) {
+    return std::min(n, hi_b * block_size) - lo_b * block_size;
+  }, [&] (size_type b) {
+    size_type i = b * block_size;
+    size_type j = std::min(n, i + block_size);
+    visit(i, lo + i, lo + j);
+  });
+}
+
+/* Maps the file at path, checks its header, and calls
+ * read_items(n, items) on the number of items and the pointer to their
+ * encodings.
+ */
+template <class Item, class Read_items>
+void deserialize(const std::string& path, serial_kind kind, const Read_items& read_items) {
+  using traits = serial_traits<Item>;
+  mmap_view<char> view(path, false);
+  if (view.size() < serial_header_size) {
+    die("%s is not a serialized container", path.c_str());
+  }
+  serial_header h;
+  memcpy(&h, view.cbegin(), sizeof(h));
+  if (h.magic != serial_magic) {
+    die("%s is not a serialized container", path.c_str());
+  }
+  if (h.version != serial_version) {
+    die("%s has format version %u, expected %u", path.c_str(), h.version, serial_version);
+  }
+  if (h.kind != (uint32_t)kind || h.item_size != traits::size) {
+    die("%s holds a container of another type", path.c_str());
+  }
+  if (view.size() != serial_header_size + h.nb_items * traits::size) {
+    die("%s is truncated", path.c_str());
+  }
+  read_items((size_type)h.nb_items, view.cbegin() + serial_header_size);
+}
+
+// appends to dst the n items encoded at src, in bulk
+template <class Chunkedseq>
+void stream_decode_dst(size_type n, const char* src, Chunkedseq& dst) {
+  using value_type = typename Chunkedseq::value_type;
+  using traits = serial_traits<value_type>;
+  using input_type = level4::tabulate_input;
+  using output_type = level3::chunkedseq_output<Chunkedseq>;
+  input_type in(0, n);
+  output_type out;
+  Chunkedseq id;
+  size_type chunk_capacity = dst.chunk_capacity;
+  auto convert = [&] (input_type& in, Chunkedseq& dst) {
+    if (traits::is_raw) {
+      // the items of the mapping are used in place as the source
+      const value_type* items = (const value_type*)src;
+      dst.stream_pushn_back([&] (size_type i, size_type m) {
+        const value_type* lo = items + in.lo + i;
+        return std::make_pair(lo, lo + m);
+      }, in.hi - in.lo);
+    } else {
+      parray<value_type> tmp(chunk_capacity);
+      dst.stream_pushn_back([&] (size_type i, size_type m) {
+        for (size_type k = 0; k < m; k++) {
+          traits::read(src + (in.lo + i + k) * traits::size, tmp[k]);
+        }
+        const value_type* lo = tmp.cbegin();
+        return std::make_pair(lo, lo + m);
+      }, in.hi - in.lo);
+    }
+  };
+  level4::reduce(in, out, id, dst, convert, convert);
+}
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+/* Serialization of containers */
+
+/* The function serialize(path, xs) writes the container xs to the file
+ * at path, and deserialize(path, xs) replaces the contents of xs by the
+ * container in the file at path. Both work in parallel.
+ */
+
+template <class Item>
+void serialize(const std::string& path, const parray<Item>& xs) {
+  __priv::serialize<Item>(path, __priv::serial_parray, xs.size(), [&] (const std::function<void(size_type, const Item*, const Item*)>& visit) {
+    __priv::for_each_block(xs.cbegin(), xs.size(), __priv::serial_block_size, visit);
+  });
+}
+
+template <class Item>
+void deserialize(const std::string& path, parray<Item>& xs) {
+  using traits = serial_traits<Item>;
+  __priv::deserialize<Item>(path, __priv::serial_parray, [&] (size_type n, const char* src) {
+    xs.tabulate(n, [&] (size_type i) {
+      Item x;
+      traits::read(src + i * traits::size, x);
+      return x;
+    });
+  });
+}
+
+template <class Item>
+void serialize(const std::string& path, const pchunkedseq<Item>& xs) {
+  __priv::serialize<Item>(path, __priv::serial_pchunkedseq, xs.seq.size(), [&] (const std::function<void(size_type, const Item*, const Item*)>& visit) {
+    chunked::for_each_segmenti(xs.seq.cbegin(), xs.seq.cend(), visit);
+  });
+}
+
+template <class Item>
+void deserialize(const std::string& path, pchunkedseq<Item>& xs) {
+  __priv::deserialize<Item>(path, __priv::serial_pchunkedseq, [&] (size_type n, const char* src) {
+    xs.clear();
+    __priv::stream_decode_dst(n, src, xs.seq);
+  });
+}
+
+template <class Item, class Compare, class Alloc, int chunk_capacity, class Cache>
+void serialize(const std::string& path, const pset<Item, Compare, Alloc, chunk_capacity, Cache>& xs,
+               __priv::serial_kind kind = __priv::serial_pset) {
+  __priv::serialize<Item>(path, kind, xs.size(), [&] (const std::function<void(size_type, const Item*, const Item*)>& visit) {
+    chunked::for_each_segmenti(xs.cbegin(), xs.cend(), visit);
+  });
+}
+
+// the items in the file are not sorted again: they are trusted to be
+// sorted and distinct, as they were when serialized
+template <class Item, class Compare, class Alloc, int chunk_capacity, class Cache>
+void deserialize(const std::string& path, pset<Item, Compare, Alloc, chunk_capacity, Cache>& xs,
+                 __priv::serial_kind kind = __priv::serial_pset) {
+  using traits = serial_traits<Item>;
+  __priv::deserialize<Item>(path, kind, [&] (size_type n, const char* src) {
+    xs.tabulate_sorted(n, [&] (size_type i, Item& dst) {
+      traits::read(src + i * traits::size, dst);
+    });
+  });
+}
+
+template <class Key, class Item, class Compare, class Alloc, int chunk_capacity>
+void serialize(const std::string& path, const pmap<Key, Item, Compare, Alloc, chunk_capacity>& xs) {
+  serialize(path, xs.set, __priv::serial_pmap);
+}
+
+template <class Key, class Item, class Compare, class Alloc, int chunk_capacity>
+void deserialize(const std::string& path, pmap<Key, Item, Compare, Alloc, chunk_capacity>& xs) {
+  deserialize(path, xs.set, __priv::serial_pmap);
+}
+
+} // end namespace
+
+#endif
@@ -1,5 +1,11 @@
 
+#include <cmath>
+#include <vector>
+
+#include "spperworker.hpp"
 #include "spdataparallel.hpp"
+#include "spsums.hpp"
+#include "sprandgen.hpp"
 
 #ifndef _SPTL_SORT_H_
 #define _SPTL_SORT_H_
@@ -14,43 +20,106 @@ namespace {
 template <class Chunkedseq, class Compare>
 Chunkedseq merge_seq(Chunkedseq& xs, Chunkedseq& ys, const Compare& compare) {
   using value_type = typename Chunkedseq::value_type;
+  using reader_type = chunked::segment_reader<typename Chunkedseq::iterator>;
   Chunkedseq result;
   size_t n = xs.size();
   size_t m = ys.size();
-  while (true) {
-    if (n == 0) {
-      result.concat(ys);
-      break;
-    } else if (m == 0) {
-      result.concat(xs);
-      break;
-    } else {
-      value_type x = xs.front();
-      value_type y = ys.front();
-      if (compare(x, y)) {
-        xs.pop_front();
-        result.push_back(x);
-        n--;
+  if ((n == 0) || (m == 0)) {
+    result.concat(xs);
+    result.concat(ys);
+    return result;
+  }
+  // number of items to be merged before one of the two sequences runs out;
+  // on equal items, those of xs are taken first
+  size_t nb;
+  if (compare(ys.back(), xs.back())) {
+    nb = m + (std::upper_bound(xs.begin(), xs.end(), ys.back(), compare) - xs.begin());
+  } else {
+    nb = n + (std::lower_bound(ys.begin(), ys.end(), xs.back(), compare) - ys.begin());
+  }
+  reader_type rx(xs.begin(), xs.end());
+  reader_type ry(ys.begin(), ys.end());
+  parray<value_type> buf(xs.chunk_capacity);
+  result.stream_pushn_back([&] (size_type, size_type k) {
+    for (size_type i = 0; i < k; i++) {
+      if (compare(ry.front(), rx.front())) {
+        buf[i] = ry.front();
+        ry.pop_front();
       } else {
-        ys.pop_front();
-        result.push_back(y);
-        m--;
+        buf[i] = rx.front();
+        rx.pop_front();
       }
     }
+    const value_type* lo = buf.cbegin();
+    const value_type* hi = lo + k;
+    return std::make_pair(lo, hi);
+  }, nb);
+  // move the remaining items of the other sequence in bulk
+  Chunkedseq rest;
+  if (rx.empty()) {
+    ys.split(ry.position(), rest);
+  } else {
+    xs.split(rx.position(), rest);
   }
+  result.concat(rest);
+  xs.clear();
+  ys.clear();
   return result;
 }
   
+/* Scratch space for sorting the items of chunked sequences, allocated
+ * by each worker the first time it is needed and reused afterwards.
+ */
+template <class Item>
+class sort_scratch {
+private:
+  
+  static
+  perworker::array<std::vector<Item>> buffers;
+  
+public:
+  
+  static
+  Item* mine(size_t n) {
+    std::vector<Item>& buffer = buffers.mine();
+    if (buffer.size() < n) {
+      buffer.resize(n);
+    }
+    return buffer.data();
+  }
+  
+};
+  
+template <class Item>
+perworker::array<std::vector<Item>> sort_scratch<Item>::buffers;
+  
+// sorts the items in place, leaving them in the chunks that hold them
 template <class Chunkedseq, class Compare>
 Chunkedseq sort_seq(Chunkedseq& xs, const Compare& compare) {
   using value_type = typename Chunkedseq::value_type;
+  using pointer = value_type*;
   Chunkedseq result;
   size_t n = xs.size();
-  parray<value_type> tmp(n);
-  xs.backn(tmp.begin(), n);
-  xs.clear();
-  std::sort(tmp.begin(), tmp.end(), compare);
-  result.pushn_back(tmp.begin(), n);
+  if (n == 0) {
+    return result;
+  }
+  auto seg = xs.begin().get_segment();
+  if ((size_t)(seg.end - seg.middle) >= n) {
+    std::sort(seg.middle, seg.middle + n, compare);
+  } else {
+    pointer tmp = sort_scratch<value_type>::mine(n);
+    pointer p = tmp;
+    pasl::data::chunkedseq::extras::for_each_segment(xs.begin(), xs.end(), [&] (pointer lo, pointer hi) {
+      p = std::copy(lo, hi, p);
+    });
+    std::sort(tmp, tmp + n, compare);
+    p = tmp;
+    pasl::data::chunkedseq::extras::for_each_segment(xs.begin(), xs.end(), [&] (pointer lo, pointer hi) {
+      std::copy(p, p + (hi - lo), lo);
+      p += hi - lo;
+    });
+  }
+  result.swap(xs);
   return result;
 }
     
@@ -207,6 +276,12 @@ size_t lower_bound(const Item* xs, size_t lo, size_t hi, const Item& val, const
   return std::lower_bound(first_xs + lo, first_xs + hi, val, compare) - first_xs;
 }
 
+template <class Item, class Compare>
+size_t upper_bound(const Item* xs, size_t lo, size_t hi, const Item& val, const Compare& compare) {
+  const Item* first_xs = &xs[0];
+  return std::upper_bound(first_xs + lo, first_xs + hi, val, compare) - first_xs;
+}
+
 template <class Item, class Compare>
 void merge_par(const Item* xs, const Item* ys, Item* tmp,
                size_t lo_xs, size_t hi_xs,
@@ -215,25 +290,34 @@ void merge_par(const Item* xs, const Item* ys, Item* tmp,
                const Compare& compare) {
   size_t n1 = hi_xs - lo_xs;
   size_t n2 = hi_ys - lo_ys;
+  // the merge is stable: items of xs go before the items of ys that
+  // compare equal to them
   spguard([&] { return n1 + n2; }, [&] {
-    if (n1 < n2) {
-      // to ensure that the first subarray being sorted is the larger or the two
-      merge_par(ys, xs, tmp, lo_ys, hi_ys, lo_xs, hi_xs, lo_tmp, compare);
-    } else if (n1 == 0) {
-      // xs and ys empty
-    } else if (n1 == 1) {
+    if ((n1 <= 1) && (n2 <= 1)) {
       if (n2 == 0) {
-        // xs singleton; ys empty
-        tmp[lo_tmp] = xs[lo_xs];
+        if (n1 == 1) {
+          // xs singleton; ys empty
+          tmp[lo_tmp] = xs[lo_xs];
+        }
+      } else if (n1 == 0) {
+        // xs empty; ys singleton
+        tmp[lo_tmp] = ys[lo_ys];
       } else {
         // both singletons
-        tmp[lo_tmp+0] = std::min(xs[lo_xs], ys[lo_ys], compare);
-        tmp[lo_tmp+1] = std::max(xs[lo_xs], ys[lo_ys], compare);
+        bool ys_first = compare(ys[lo_ys], xs[lo_xs]);
+        tmp[lo_tmp+0] = ys_first ? ys[lo_ys] : xs[lo_xs];
+        tmp[lo_tmp+1] = ys_first ? xs[lo_xs] : ys[lo_ys];
       }
     } else {
-      // select pivot positions
-      size_t mid_xs = (lo_xs + hi_xs) / 2;
-      size_t mid_ys = lower_bound(ys, lo_ys, hi_ys, xs[mid_xs], compare);
+      // select pivot positions, by splitting the larger of the two subarrays
+      size_t mid_xs, mid_ys;
+      if (n1 >= n2) {
+        mid_xs = (lo_xs + hi_xs) / 2;
+        mid_ys = lower_bound(ys, lo_ys, hi_ys, xs[mid_xs], compare);
+      } else {
+        mid_ys = (lo_ys + hi_ys) / 2;
+        mid_xs = upper_bound(xs, lo_xs, hi_xs, ys[mid_ys], compare);
+      }
       // number of items to be treated by the first parallel call
       size_t k = (mid_xs - lo_xs) + (mid_ys - lo_ys);
       fork2([&] {
@@ -247,11 +331,28 @@ void merge_par(const Item* xs, const Item* ys, Item* tmp,
   });
 }
  
+// sorted range [lo, hi), whose items are stored in either the source
+// array or the temporary array, depending on in_tmp
+class mergesort_range {
+public:
+  
+  size_type lo;
+  size_type hi;
+  bool in_tmp;
+  
+  mergesort_range()
+  : lo(0), hi(0), in_tmp(false) { }
+  
+  mergesort_range(size_type lo, size_type hi, bool in_tmp)
+  : lo(lo), hi(hi), in_tmp(in_tmp) { }
+  
+};
+  
 template <class Merge_fct>
 class mergesort_merge_output {
 public:
   
-  using result_type = std::pair<size_t, size_t>;
+  using result_type = mergesort_range;
 
   Merge_fct merge_fct;
   
@@ -259,7 +360,7 @@ public:
   : merge_fct(merge_fct) { }
   
   void init(result_type& rng) const {
-    rng = std::make_pair(0L, 0L);
+    rng = result_type();
   }
   
   void copy(const result_type& src, result_type& dst) const {
@@ -268,37 +369,56 @@ public:
   
   // dst, src represent left, right range to be merged, respectively
   void merge(const result_type& src, result_type& dst) const {
-    assert(dst.second == src.first);
-    merge_fct(dst.first, dst.second, src.second);
-    dst.second = src.second;
+    assert(dst.hi == src.lo);
+    dst.in_tmp = merge_fct(dst, src);
+    dst.hi = src.hi;
   }
   
 };
   
-template <class Item, class Compare>
-void mergesort(Item* xs, Item* tmp, size_t lo, size_t hi, const Compare& compare) {
+template <class Item, class Compare, class Seq_sort>
+void mergesort(Item* xs, Item* tmp, size_t lo, size_t hi,
+               const Compare& compare, const Seq_sort& seq_sort) {
   using input_type = level4::tabulate_input;
-  auto merge_fct = [&] (size_t lo, size_t mid, size_t hi) {
-    merge_par(xs, xs, tmp, lo, mid, mid, hi, lo, compare);
-    // copy back to source array
-    copy(&tmp[lo], &tmp[hi], &xs[lo]);
+  using result_type = mergesort_range;
+  auto buffer = [&] (bool in_tmp) {
+    return in_tmp ? tmp : xs;
+  };
+  // merges two adjacent sorted ranges from one array into the other one,
+  // so that successive levels of merging alternate between the two arrays
+  // rather than copying back to the source array after each merge;
+  // returns true if the merged range is stored in the temporary array
+  auto merge_fct = [&] (const result_type& left, const result_type& right) {
+    bool in_tmp = left.in_tmp;
+    if (left.in_tmp != right.in_tmp) {
+      // the two ranges were sorted at different depths: move the smaller
+      // one to the array holding the larger one
+      const result_type& src = ((left.hi - left.lo) < (right.hi - right.lo)) ? left : right;
+      in_tmp = ! src.in_tmp;
+      sptl::copy(buffer(src.in_tmp) + src.lo, buffer(src.in_tmp) + src.hi, buffer(in_tmp) + src.lo);
+    }
+    merge_par(buffer(in_tmp), buffer(in_tmp), buffer(! in_tmp),
+              left.lo, left.hi, right.lo, right.hi, left.lo, compare);
+    return ! in_tmp;
   };
   using output_type = mergesort_merge_output<decltype(merge_fct)>;
-  using result_type = typename output_type::result_type;
   input_type in(lo, hi);
   output_type out(merge_fct);
-  result_type id = std::make_pair(0L, 0L);
+  result_type id;
   result_type dst = id;
   auto convert_reduce = [&] (input_type& in, result_type& dst) {
     if ((in.hi - in.lo) > 1){
-      std::sort(xs + in.lo, xs + in.hi, compare);
+      seq_sort(xs + in.lo, xs + in.hi);
     }
-    dst = std::make_pair(in.lo, in.hi);
+    dst = result_type(in.lo, in.hi, false);
   };
   auto seq_convert_reduce = convert_reduce;
   level4::reduce(in, out, id, dst, convert_reduce, seq_convert_reduce);
-  assert(dst.first == lo);
-  assert(dst.second == hi);
+  assert(dst.lo == lo);
+  assert(dst.hi == hi);
+  if (dst.in_tmp) {
+    sptl::copy(tmp + lo, tmp + hi, xs + lo);
+  }
 }
   
 } // end namespace
@@ -327,7 +447,9 @@ void mergesort(Iter lo, Iter hi, const Compare& compare) {
   using value_type = typename std::iterator_traits<Iter>::value_type;
   size_t n = hi - lo;
   parray<value_type> tmp(n);
-  mergesort(lo, tmp.begin(), 0L, n, compare);
+  mergesort(lo, tmp.begin(), 0L, n, compare, [&] (value_type* lo, value_type* hi) {
+    std::sort(lo, hi, compare);
+  });
 }
   
 template <class Iter, class Compare>
@@ -335,6 +457,526 @@ void sort(Iter lo, Iter hi, const Compare& compare) {
   mergesort(lo, hi, compare);
 }
   
+/* Same as sort, except that the relative order of equal items is
+ * preserved.
+ */
+template <class Iter, class Compare>
+void stable_sort(Iter lo, Iter hi, const Compare& compare) {
+  using value_type = typename std::iterator_traits<Iter>::value_type;
+  size_t n = hi - lo;
+  parray<value_type> tmp(n);
+  mergesort(lo, tmp.begin(), 0L, n, compare, [&] (value_type* lo, value_type* hi) {
+    std::stable_sort(lo, hi, compare);
+  });
+}
+  
+/*---------------------------------------------------------------------*/
+/* Bucket distribution for parallel arrays */
+  
+namespace {
+  
+static constexpr
+size_type distribute_max_nb_buckets = 256;
+  
+static constexpr
+size_type distribute_block_size = 1 << 14;
+  
+/* Moves the items of src to dst, grouped by the bucket numbers that are
+ * assigned to them by bucket_of, and such that the relative order of the
+ * items in each bucket is preserved. The input is processed in blocks:
+ * each block computes its own histogram and the histograms are then
+ * scanned in column-major order to obtain the position in dst of each
+ * (bucket, block) pair.
+ *
+ * On return, bucket b occupies [offsets[b], offsets[b+1]) in dst. If all
+ * items fall in the same bucket, the function returns false and leaves
+ * dst untouched.
+ *
+ * The bucket of the item src[i] is given by bucket_of_index(i).
+ */
+template <class Item, class Bucket_of_index>
+bool distribute_indexed(const Item* src, Item* dst, size_type n,
+                        size_type nb_buckets, size_type nb_blocks,
+                        const Bucket_of_index& bucket_of_index,
+                        parray<size_type>& offsets) {
+  assert(nb_buckets <= distribute_max_nb_buckets);
+  auto block_rng = [&] (size_type b) {
+    size_type lo = b * distribute_block_size;
+    size_type hi = std::min(lo + distribute_block_size, n);
+    return std::make_pair(lo, hi);
+  };
+  auto comp_rng = [&] (size_type lo, size_type hi) {
+    return block_rng(hi - 1).second - block_rng(lo).first;
+  };
+  // histogram of each block, stored row major: counts[b * nb_buckets + d]
+  parray<size_type> counts(nb_blocks * nb_buckets, (size_type)0);
+  parallel_for((size_type)0, nb_blocks, comp_rng, [&] (size_type b) {
+    size_type* cnt = &counts[b * nb_buckets];
+    auto rng = block_rng(b);
+    for (size_type i = rng.first; i < rng.second; i++) {
+      cnt[bucket_of_index(i)]++;
+    }
+  });
+  parray<size_type> block_offsets = sums(nb_blocks * nb_buckets, [&] (size_type i) {
+    size_type d = i / nb_blocks;
+    size_type b = i % nb_blocks;
+    return counts[b * nb_buckets + d];
+  });
+  offsets.tabulate(nb_buckets + 1, [&] (size_type d) {
+    return block_offsets[d * nb_blocks];
+  });
+  for (size_type d = 0; d < nb_buckets; d++) {
+    if (offsets[d + 1] - offsets[d] == n) {
+      return false;
+    }
+  }
+  parallel_for((size_type)0, nb_blocks, comp_rng, [&] (size_type b) {
+    size_type offs[distribute_max_nb_buckets];
+    for (size_type d = 0; d < nb_buckets; d++) {
+      offs[d] = block_offsets[d * nb_blocks + b];
+    }
+    auto rng = block_rng(b);
+    for (size_type i = rng.first; i < rng.second; i++) {
+      dst[offs[bucket_of_index(i)]++] = src[i];
+    }
+  });
+  return true;
+}
+  
+// same as distribute_indexed, with the bucket of each item given by
+// bucket_of(item)
+template <class Item, class Bucket_of>
+bool distribute(const Item* src, Item* dst, size_type n,
+                size_type nb_buckets, size_type nb_blocks,
+                const Bucket_of& bucket_of,
+                parray<size_type>& offsets) {
+  return distribute_indexed(src, dst, n, nb_buckets, nb_blocks, [&] (size_type i) {
+    return bucket_of(src[i]);
+  }, offsets);
+}
+  
+static inline
+size_type distribute_nb_blocks(size_type n) {
+  return 1 + ((n - 1) / distribute_block_size);
+}
+  
+} // end namespace
+  
+/*---------------------------------------------------------------------*/
+/* Sample sorting for parallel arrays */
+  
+namespace {
+  
+static constexpr
+size_type sample_sort_oversampling = 16;
+  
+static constexpr
+size_type sample_sort_bucket_size = 1 << 14;
+  
+// binary search tree of splitters, laid out in breadth-first order in
+// tree[1, nb_buckets), so that classifying an item takes exactly
+// log2(nb_buckets) comparisons, without branching on their outcomes
+template <class Item, class Compare>
+class splitter_tree {
+public:
+  
+  size_type nb_buckets;
+  size_type depth;
+  parray<Item> tree;
+  const Compare& compare;
+  
+  // pre: splitters is sorted and of size nb_buckets - 1,
+  // nb_buckets is a power of two
+  splitter_tree(const parray<Item>& splitters, size_type nb_buckets, const Compare& compare)
+  : nb_buckets(nb_buckets), depth(0), tree(nb_buckets), compare(compare) {
+    while (((size_type)1 << depth) < nb_buckets) {
+      depth++;
+    }
+    for (size_type l = 0; l < depth; l++) {
+      size_type stride = nb_buckets >> (l + 1);
+      for (size_type p = 0; p < ((size_type)1 << l); p++) {
+        tree[((size_type)1 << l) + p] = splitters[(2 * p + 1) * stride - 1];
+      }
+    }
+  }
+  
+  // returns b such that splitters[b-1] < x <= splitters[b]
+  size_type bucket_of(const Item& x) const {
+    size_type j = 1;
+    for (size_type l = 0; l < depth; l++) {
+      j = 2 * j + (size_type)compare(tree[j], x);
+    }
+    return j - nb_buckets;
+  }
+  
+};
+  
+template <class Item, class Compare>
+void sample_sort(Item* xs, size_type n, const Compare& compare) {
+  spguard([&] { return n * std::log2(std::max((size_type)2, n)); }, [&] {
+    size_type nb_buckets = 2;
+    while ((nb_buckets < distribute_max_nb_buckets) && (nb_buckets * sample_sort_bucket_size < n)) {
+      nb_buckets *= 2;
+    }
+    size_type nb_samples = nb_buckets * sample_sort_oversampling;
+    parray<Item> samples(nb_samples, [&] (size_type i) {
+      return xs[hashu((unsigned int)(n + i)) % n];
+    });
+    std::sort(samples.begin(), samples.end(), compare);
+    parray<Item> splitters(nb_buckets - 1, [&] (size_type i) {
+      return samples[(i + 1) * sample_sort_oversampling];
+    });
+    splitter_tree<Item, Compare> splitter(splitters, nb_buckets, compare);
+    parray<Item> tmp;
+    tmp.reset(n);
+    parray<size_type> offsets;
+    bool split = distribute(xs, tmp.begin(), n, nb_buckets, distribute_nb_blocks(n), [&] (const Item& x) {
+      return splitter.bucket_of(x);
+    }, offsets);
+    if (! split) {
+      // too many duplicate keys for the splitters to tell them apart
+      sptl::mergesort(xs, xs + n, compare);
+      return;
+    }
+    auto comp_rng = [&] (size_type lo, size_type hi) {
+      size_type m = offsets[hi] - offsets[lo];
+      return m * std::log2(std::max((size_type)2, m));
+    };
+    parallel_for((size_type)0, nb_buckets, comp_rng, [&] (size_type b) {
+      size_type lo = offsets[b];
+      size_type hi = offsets[b + 1];
+      sptl::copy(tmp.cbegin() + lo, tmp.cbegin() + hi, xs + lo);
+      if (2 * (hi - lo) > n) {
+        // skewed bucket: recursing would make little progress
+        sptl::mergesort(xs + lo, xs + hi, compare);
+      } else {
+        sample_sort(xs + lo, hi - lo, compare);
+      }
+    });
+  }, [&] {
+    std::sort(xs, xs + n, compare);
+  });
+}
+  
+} // end namespace
+  
+/* Sorts the items in [lo, hi) by partitioning them into buckets
+ * delimited by splitters drawn from an oversampled subsequence of
+ * the input, and then sorting the buckets in parallel. Compared to
+ * mergesort, the items are moved only a constant number of times per
+ * level of bucketing.
+ */
+template <class Iter, class Compare>
+void sample_sort(Iter lo, Iter hi, const Compare& compare) {
+  size_type n = hi - lo;
+  if (n <= 1) {
+    return;
+  }
+  sample_sort(&lo[0], n, compare);
+}
+  
+/*---------------------------------------------------------------------*/
+/* Random permutations for parallel arrays */
+  
+namespace {
+  
+static constexpr
+size_type shuffle_leaf_size = 1 << 14;
+  
+// Fisher-Yates, drawing the random words from the stream of seed
+template <class Item>
+void shuffle_seq(Item* xs, size_type n, uint64_t seed) {
+  philox4x32 gen(seed);
+  philox4x32::block_type block;
+  for (size_type i = n; i > 1; i--) {
+    size_type k = n - i;
+    if (k % 2 == 0) {
+      block = gen((uint64_t)(k / 2));
+    }
+    const uint32_t* w = &block[2 * (k % 2)];
+    uint64_t x = ((uint64_t)w[1] << 32) | w[0];
+    size_type j = (size_type)(((unsigned __int128)x * i) >> 64);
+    std::swap(xs[i - 1], xs[j]);
+  }
+}
+  
+/* Sends each item to one of nb_buckets buckets chosen uniformly at
+ * random, which takes one stable distribution pass, and then shuffles
+ * the buckets independently, in parallel. The result is a uniformly
+ * random permutation. The random choices are drawn from streams that
+ * depend only on the seed and on the position of the subproblem, and
+ * the recursion does not depend on the schedule, so the result does not
+ * depend on the number of workers.
+ */
+template <class Item>
+void shuffle(Item* xs, size_type n, uint64_t seed) {
+  if (n <= shuffle_leaf_size) {
+    shuffle_seq(xs, n, seed);
+    return;
+  }
+  size_type nb_buckets = 2;
+  while ((nb_buckets < distribute_max_nb_buckets) && (nb_buckets * shuffle_leaf_size < n)) {
+    nb_buckets *= 2;
+  }
+  // one byte of random bits per item
+  parray<unsigned char> buckets = __priv::random_tabulate<unsigned char>(n, seed, 16, [&] (const uint32_t* w, unsigned char* dst, size_type m) {
+    const unsigned char* bytes = (const unsigned char*)w;
+    for (size_type j = 0; j < m; j++) {
+      dst[j] = bytes[j] & (nb_buckets - 1);
+    }
+  });
+  parray<Item> tmp;
+  tmp.reset(n);
+  parray<size_type> offsets;
+  if (! distribute_indexed(xs, tmp.begin(), n, nb_buckets, distribute_nb_blocks(n), [&] (size_type i) {
+    return buckets[i];
+  }, offsets)) {
+    sptl::copy(xs, xs + n, tmp.begin());
+  }
+  parallel_for((size_type)0, nb_buckets, [&] (size_type lo, size_type hi) {
+    return offsets[hi] - offsets[lo];
+  }, [&] (size_type b) {
+    size_type lo = offsets[b];
+    size_type hi = offsets[b + 1];
+    sptl::copy(tmp.cbegin() + lo, tmp.cbegin() + hi, xs + lo);
+    shuffle(xs + lo, hi - lo, hash64(hash64(seed) + b + 1));
+  });
+}
+  
+} // end namespace
+  
+/* Rearranges the items in [lo, hi) in an order chosen uniformly at
+ * random. The order depends only on the seed and on the number of
+ * items.
+ */
+template <class Iter>
+void shuffle(Iter lo, Iter hi, uint64_t seed) {
+  size_type n = hi - lo;
+  if (n <= 1) {
+    return;
+  }
+  shuffle(&lo[0], n, seed);
+}
+  
+// returns a permutation of 0, ..., n-1 chosen uniformly at random
+inline
+parray<size_type> random_permutation(size_type n, uint64_t seed) {
+  parray<size_type> result(n, [&] (size_type i) {
+    return i;
+  });
+  sptl::shuffle(result.begin(), result.end(), seed);
+  return result;
+}
+  
+/*---------------------------------------------------------------------*/
+/* Selection for parallel arrays */
+  
+namespace {
+  
+template <class Item, class Compare>
+const Item& median_of_three(const Item& x, const Item& y, const Item& z, const Compare& compare) {
+  if (compare(x, y)) {
+    return compare(y, z) ? y : (compare(x, z) ? z : x);
+  } else {
+    return compare(x, z) ? x : (compare(y, z) ? z : y);
+  }
+}
+  
+// quickselect: partitions xs[0, n) in three around a pivot, and
+// continues in the part that contains position k
+template <class Item, class Compare>
+void nth_element(Item* xs, size_type n, size_type k, const Compare& compare) {
+  spguard([&] { return n; }, [&] {
+    Item pivot = median_of_three(xs[hashu((unsigned int)n) % n],
+                                 xs[hashu((unsigned int)(n + 1)) % n],
+                                 xs[hashu((unsigned int)(n + 2)) % n], compare);
+    auto split = sptl::partition3(xs, xs + n, [&] (const Item& x) {
+      return compare(x, pivot);
+    }, [&] (const Item& x) {
+      return ! compare(pivot, x);
+    });
+    size_type nb_less = split.first;
+    size_type nb_less_or_equal = split.second;
+    if (k < nb_less) {
+      nth_element(xs, nb_less, k, compare);
+    } else if (k >= nb_less_or_equal) {
+      nth_element(xs + nb_less_or_equal, n - nb_less_or_equal, k - nb_less_or_equal, compare);
+    }
+  }, [&] {
+    std::nth_element(xs, xs + k, xs + n, compare);
+  });
+}
+  
+// the up to k first items of a sequence, in sorted order
+template <class Item, class Compare>
+class top_k_output {
+public:
+  
+  using result_type = std::vector<Item>;
+  
+  size_type k;
+  const Compare& compare;
+  
+  top_k_output(size_type k, const Compare& compare)
+  : k(k), compare(compare) { }
+  
+  void init(result_type& dst) const {
+    dst.clear();
+  }
+  
+  // dst, src represent left, right results to be merged, respectively
+  void merge(const result_type& src, result_type& dst) const {
+    size_type m = std::min(k, (size_type)(src.size() + dst.size()));
+    result_type tmp;
+    tmp.reserve(m);
+    size_type i = 0;
+    size_type j = 0;
+    while (tmp.size() < m) {
+      if ((j == src.size()) || ((i < dst.size()) && ! compare(src[j], dst[i]))) {
+        tmp.push_back(dst[i++]);
+      } else {
+        tmp.push_back(src[j++]);
+      }
+    }
+    dst.swap(tmp);
+  }
+  
+};
+  
+} // end namespace
+  
+/* Rearranges the items in [lo, hi) such that the item at position nth
+ * is the one that would be there if the range were sorted, and that
+ * no item before nth is greater than it and no item after nth is less
+ * than it.
+ */
+template <class Iter, class Compare>
+void nth_element(Iter lo, Iter nth, Iter hi, const Compare& compare) {
+  size_type n = hi - lo;
+  if (nth == hi) {
+    return;
+  }
+  nth_element(&lo[0], n, (size_type)(nth - lo), compare);
+}
+  
+/* Rearranges the items in [lo, hi) such that the range [lo, middle)
+ * contains, in sorted order, the middle - lo smallest items.
+ */
+template <class Iter, class Compare>
+void partial_sort(Iter lo, Iter middle, Iter hi, const Compare& compare) {
+  if (middle == lo) {
+    return;
+  }
+  sptl::nth_element(lo, middle - 1, hi, compare);
+  sptl::sort(lo, middle - 1, compare);
+}
+  
+/* Returns, in sorted order, the k smallest items in [lo, hi), without
+ * modifying the range. Each leaf of the reduction keeps the best k items
+ * it has seen so far in a bounded heap, and the per-leaf results are
+ * merged pairwise, so the work is O(n log k).
+ */
+template <class Iter, class Compare>
+parray<value_type_of<Iter>> top_k(Iter lo, Iter hi, size_type k, const Compare& compare) {
+  using value_type = value_type_of<Iter>;
+  using input_type = level4::random_access_iterator_input<Iter>;
+  using output_type = top_k_output<value_type, Compare>;
+  using result_type = typename output_type::result_type;
+  input_type in(lo, hi);
+  output_type out(k, compare);
+  result_type id;
+  result_type dst;
+  auto convert_reduce = [&] (input_type& in, result_type& dst) {
+    result_type heap;
+    if (k > 0) {
+      for (Iter it = in.lo; it != in.hi; it++) {
+        if (heap.size() < k) {
+          heap.push_back(*it);
+          std::push_heap(heap.begin(), heap.end(), compare);
+        } else if (compare(*it, heap.front())) {
+          std::pop_heap(heap.begin(), heap.end(), compare);
+          heap.back() = *it;
+          std::push_heap(heap.begin(), heap.end(), compare);
+        }
+      }
+    }
+    std::sort_heap(heap.begin(), heap.end(), compare);
+    dst.swap(heap);
+  };
+  auto seq_convert_reduce = convert_reduce;
+  level4::reduce(in, out, id, dst, convert_reduce, seq_convert_reduce);
+  return parray<value_type>(dst.size(), [&] (size_type i) {
+    return dst[i];
+  });
+}
+  
+/*---------------------------------------------------------------------*/
+/* Integer sorting for parallel arrays */
+  
+namespace {
+  
+static constexpr
+int radix_digit_nb_bits = 8;
+  
+static constexpr
+size_type radix_nb_buckets = 1 << radix_digit_nb_bits;
+  
+template <class Item, class Key_fn>
+void radix_sort(Item* xs, Item* tmp, size_type n, const Key_fn& key_fn, int bits) {
+  size_type nb_passes = (bits + radix_digit_nb_bits - 1) / radix_digit_nb_bits;
+  auto rec = [&] (size_type nb_blocks) {
+    Item* src = xs;
+    Item* dst = tmp;
+    parray<size_type> offsets;
+    for (int shift = 0; shift < bits; shift += radix_digit_nb_bits) {
+      auto digit = [&] (const Item& x) {
+        return (size_type)(key_fn(x) >> shift) & (radix_nb_buckets - 1);
+      };
+      // a pass is skipped if all keys share the same digit
+      if (distribute(src, dst, n, radix_nb_buckets, nb_blocks, digit, offsets)) {
+        std::swap(src, dst);
+      }
+    }
+    if (src != xs) {
+      sptl::copy(src, src + n, xs);
+    }
+  };
+  spguard([&] { return n * nb_passes; }, [&] {
+    rec(distribute_nb_blocks(n));
+  }, [&] {
+    rec(1);
+  });
+}
+  
+} // end namespace
+  
+/* Sorts the items in [lo, hi) by the unsigned integer keys returned by
+ * key_fn, of which only the low-order bits are considered. The sort is
+ * stable and makes one least-significant-digit pass per byte of key.
+ * A number of bits larger than the width of the keys is clamped to it.
+ */
+template <class Iter, class Key_fn>
+void radix_sort(Iter lo, Iter hi, const Key_fn& key_fn, int bits) {
+  using value_type = value_type_of<Iter>;
+  using key_type = typename std::decay<decltype(key_fn(*lo))>::type;
+  assert(bits >= 0);
+  // shifting a key by its width or more is undefined
+  bits = std::min(bits, (int)(8 * sizeof(key_type)));
+  size_type n = hi - lo;
+  if (n <= 1) {
+    return;
+  }
+  parray<value_type> tmp;
+  tmp.reset(n);
+  radix_sort(&lo[0], tmp.begin(), n, key_fn, bits);
+}
+  
+template <class Iter, class Key_fn>
+void radix_sort(Iter lo, Iter hi, const Key_fn& key_fn) {
+  using key_type = typename std::decay<decltype(key_fn(*lo))>::type;
+  radix_sort(lo, hi, key_fn, (int)(8 * sizeof(key_type)));
+}
+  
 } // end namespace
 
 #endif
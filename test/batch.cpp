@@ -0,0 +1,86 @@
+#include <map>
+#include <set>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "sppmap.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  template <class Set>
+  bool same_items(const pset<int>& s, const Set& e) {
+    return s.size() == e.size() && std::equal(s.cbegin(), s.cend(), e.begin());
+  }
+
+  void test_pset() {
+    for (int n : { 0, 1, 100, 30000 }) {
+      for (int m : { 0, 1, 7, 5000, 100000 }) {
+        int nb_keys = 3 * n + 10;
+        parray<int> xs(n, [&] (size_type i) {
+          return (int)(hash64(i) % nb_keys);
+        });
+        parray<int> ys(m, [&] (size_type i) {
+          return (int)(hash64(i + 77) % nb_keys);
+        });
+        pset<int> s(xs.cbegin(), xs.cend());
+        std::set<int> e(xs.cbegin(), xs.cend());
+        s.insert_batch(ys.cbegin(), ys.cend());
+        e.insert(ys.cbegin(), ys.cend());
+        check(same_items(s, e), "pset::insert_batch");
+        parray<pset<int>::const_iterator> fs = s.find_batch(ys.cbegin(), ys.cend());
+        bool ok = true;
+        for (int i = 0; i < m && ok; i++) {
+          ok = fs[i] != s.cend() && *fs[i] == ys[i];
+        }
+        check(ok, "pset::find_batch, present keys");
+        parray<int> zs(m, [&] (size_type i) {
+          return (int)(hash64(i + 1234) % nb_keys);
+        });
+        size_type nb = e.size();
+        for (int i = 0; i < m; i++) {
+          e.erase(zs[i]);
+        }
+        check(s.erase_batch(zs.cbegin(), zs.cend()) == nb - e.size(), "pset::erase_batch, count");
+        check(same_items(s, e), "pset::erase_batch");
+        fs = s.find_batch(zs.cbegin(), zs.cend());
+        ok = true;
+        for (int i = 0; i < m && ok; i++) {
+          ok = fs[i] == s.cend();
+        }
+        check(ok, "pset::find_batch, absent keys");
+        // the set remains usable by the single-item operations
+        s.insert(-1);
+        check(s.find(-1) != s.cend() && *s.cbegin() == -1, "pset::insert after batch");
+      }
+    }
+  }
+
+  void test_pmap() {
+    pmap<int, int> m;
+    m.insert(std::make_pair(5, 50));
+    // the first item of a key wins, and items already there are kept
+    parray<std::pair<int, int>> kvs = { { 3, 1 }, { 1, 2 }, { 3, 5 }, { 9, 9 }, { 5, 0 } };
+    m.insert_batch(kvs.cbegin(), kvs.cend());
+    parray<int> ks = { 3, 1, 4, 5 };
+    auto fs = m.find_batch(ks.cbegin(), ks.cend());
+    check(m.size() == 4, "pmap::insert_batch, size");
+    check((*fs[0]).second == 1 && (*fs[1]).second == 2 && fs[2] == m.cend()
+          && (*fs[3]).second == 50, "pmap::find_batch");
+    parray<int> es = { 3, 4, 3 };
+    check(m.erase_batch(es.cbegin(), es.cend()) == 1 && m.size() == 3, "pmap::erase_batch");
+    check(m.find(3) == m.cend() && m[9] == 9, "pmap::erase_batch, remaining keys");
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_pset();
+    sptl::test_pmap();
+    r = sptl::report("batch");
+  });
+  return r;
+}
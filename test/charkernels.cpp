@@ -0,0 +1,70 @@
+#include <vector>
+
+#include "cmdline.hpp"
+#include "spcharkernels.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  // checks each version of the kernels against the scalar one, on short
+  // random ranges drawn from a small alphabet, so that the vector loops
+  // and their scalar tails both run
+  void test() {
+    const char alphabet[] = "abc \n,;\t\0\xff";
+    const char set_alphabet[] = "xyz \n,;\t\xff";
+    unsigned r = 1;
+    auto next = [&] (unsigned m) {
+      r = hashu(r);
+      return r % m;
+    };
+    for (int t = 0; t < 3000; t++) {
+      int n = next(300);
+      std::vector<char> xs(n);
+      for (auto& x : xs) {
+        x = alphabet[next(10)];
+      }
+      const char* lo = xs.data();
+      const char* hi = lo + n;
+      char c = alphabet[next(6)];
+      int nset = 1 + next(12);
+      char set[16];
+      for (int k = 0; k < nset; k++) {
+        set[k] = set_alphabet[next(9)];
+      }
+      const char* first = simd::scalar::find_any_of(lo, hi, set, nset);
+      std::vector<char> marks(n + 1, 7);
+      std::vector<char> marks2(n + 1, 7);
+      simd::scalar::mark_any_of(lo, hi, set, nset, (bool*)marks.data());
+      simd::mark_any_of(lo, hi, set, nset, (bool*)marks2.data());
+      check(simd::find_char(lo, hi, c) == simd::scalar::find_char(lo, hi, c), "find_char");
+      check(simd::count_char(lo, hi, c) == simd::scalar::count_char(lo, hi, c), "count_char");
+      check(simd::find_any_of(lo, hi, set, nset) == first, "find_any_of");
+      check(marks == marks2, "mark_any_of");
+#ifdef SPTL_HAVE_X86_KERNELS
+      if (simd::cpu_has_avx2()) {
+        check(simd::avx2::find_char(lo, hi, c) == simd::scalar::find_char(lo, hi, c),
+              "avx2::find_char");
+        check(simd::avx2::count_char(lo, hi, c) == simd::scalar::count_char(lo, hi, c),
+              "avx2::count_char");
+        if (nset <= simd::avx2::max_set_size) {
+          check(simd::avx2::find_any_of(lo, hi, set, nset) == first, "avx2::find_any_of");
+        }
+      }
+      if (simd::cpu_has_sse42()) {
+        check(simd::sse42::find_any_of(lo, hi, set, nset) == first, "sse42::find_any_of");
+      }
+#endif
+    }
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("charkernels");
+  });
+  return r;
+}
@@ -0,0 +1,29 @@
+#include <cstdlib>
+#include <iostream>
+
+#ifndef _SPTL_TEST_CHECK_H_
+#define _SPTL_TEST_CHECK_H_
+
+namespace sptl {
+
+  // reports and counts the failed checks; a test program returns the
+  // number of failures, so that "make check" stops at the first failing one
+  static int nb_failures = 0;
+  
+  static void check(bool b, const char* what) {
+    if (! b) {
+      std::cerr << "FAILED\t" << what << std::endl;
+      nb_failures++;
+    }
+  }
+  
+  static int report(const char* name) {
+    if (nb_failures == 0) {
+      std::cout << name << "\tok" << std::endl;
+    }
+    return nb_failures;
+  }
+  
+} // end namespace
+
+#endif
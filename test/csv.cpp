@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <string>
+
+#include "cmdline.hpp"
+#include "spcsv.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  std::string quoted_name(int i) {
+    return "n,a\nme \"" + std::to_string(i) + "\"";
+  }
+  
+  void test_csv() {
+    int n = 50000;
+    // a header, rows with quoted fields that hold delimiters, newlines
+    // and quotes, both line endings, a malformed row and a last row
+    // without a newline
+    std::string text = "id,name,score\r\n";
+    for (int i = 0; i < n; i++) {
+      text += std::to_string(i) + ",";
+      if (i % 3 == 0) {
+        text += "\"n,a\nme \"\"" + std::to_string(i) + "\"\"\"";
+      } else {
+        text += "nm" + std::to_string(i);
+      }
+      text += "," + std::to_string(i * 0.5) + ((i % 2 == 1) ? "\r\n" : "\n");
+    }
+    text += "bad,row\n";
+    text += "7,x,1e3";
+    const char* dir = getenv("TMPDIR");
+    std::string path = std::string((dir == nullptr) ? "/tmp" : dir) + "/sptl_test_csv";
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+    csv_table table = read_csv(path);
+    remove(path.c_str());
+    check(table.nb_columns() == 3 && table.nb_rows() == (size_type)n + 2, "dimensions");
+    check(table.header().size() == 3 && table.header()[1] == "name", "header");
+    check(table.malformed_rows().size() == 1 && table.malformed_rows()[0] == (size_type)n,
+          "malformed rows");
+    parray<size_type> malformed;
+    parray<long> ids = table.int_column(0, malformed);
+    bool ok = ids[n + 1] == 7 && malformed.size() == 1 && malformed[0] == (size_type)n;
+    for (int i = 0; i < n; i++) {
+      ok = ok && ids[i] == i;
+    }
+    check(ok, "int_column");
+    parray<double> scores = table.double_column(2, malformed);
+    ok = scores[n + 1] == 1000.0;
+    for (int i = 0; i < n; i++) {
+      ok = ok && scores[i] == i * 0.5;
+    }
+    check(ok, "double_column");
+    parray<pstring::token_type> tokens;
+    pstring names = table.string_column(1, tokens);
+    ok = true;
+    for (int i = 0; i < n; i++) {
+      std::string name = (i % 3 == 0) ? quoted_name(i) : "nm" + std::to_string(i);
+      ok = ok && std::string(names.c_str() + tokens[i].first, tokens[i].second) == name;
+      ok = ok && table.field(i, 1) == name;
+    }
+    check(ok, "string_column");
+  }
+  
+  void test_small() {
+    csv_table tsv(pstring("a\tb\n1\t2\n"), '\t', false);
+    check(tsv.nb_rows() == 2 && tsv.field(0, 1) == "b" && tsv.int_column(1)[1] == 2, "tsv");
+    csv_table empty(pstring(""), ',');
+    check(empty.nb_rows() == 0, "empty table");
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_csv();
+    sptl::test_small();
+    r = sptl::report("csv");
+  });
+  return r;
+}
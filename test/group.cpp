@@ -0,0 +1,168 @@
+#include <map>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "spgroup.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  void test_histogram_and_group_by_key() {
+    // bucket counts on both sides of the distribution threshold
+    for (size_type n : { 0ul, 1ul, 1000ul, 300000ul }) {
+      for (size_type nb : { 1ul, 7ul, 256ul, 1000ul, 70000ul }) {
+        parray<unsigned> xs(n, [&] (size_type i) {
+          return (unsigned)(hash64(i) % nb);
+        });
+        auto key = [&] (unsigned x) {
+          return (size_type)x;
+        };
+        std::vector<size_type> ref(nb, 0);
+        for (size_type i = 0; i < n; i++) {
+          ref[xs[i]]++;
+        }
+        parray<size_type> h = histogram(xs.cbegin(), xs.cend(), nb, key);
+        bool ok = h.size() == nb;
+        for (size_type k = 0; k < nb && ok; k++) {
+          ok = h[k] == ref[k];
+        }
+        check(ok, "histogram");
+        parray<size_type> offsets;
+        parray<unsigned> g = group_by_key(xs.cbegin(), xs.cend(), nb, key, offsets);
+        ok = g.size() == n && offsets.size() == nb + 1 && offsets[nb] == n;
+        size_type acc = 0;
+        for (size_type k = 0; k < nb && ok; k++) {
+          ok = offsets[k] == acc;
+          acc += ref[k];
+          for (size_type i = offsets[k]; i < offsets[k + 1] && ok; i++) {
+            ok = g[i] == k;
+          }
+        }
+        check(ok, "group_by_key");
+      }
+    }
+    // the items of each key keep their relative order
+    for (size_type nb : { 200ul, 5000ul }) {
+      parray<std::pair<int, int>> ps(100000, [&] (size_type i) {
+        return std::make_pair((int)(hash64(i) % nb), (int)i);
+      });
+      parray<size_type> offsets;
+      auto g = group_by_key(ps.cbegin(), ps.cend(), nb, [&] (std::pair<int, int> p) {
+        return p.first;
+      }, offsets);
+      bool ok = true;
+      for (size_type i = 1; i < g.size(); i++) {
+        ok = ok && (g[i - 1].first < g[i].first
+                    || (g[i - 1].first == g[i].first && g[i - 1].second < g[i].second));
+      }
+      check(ok, "group_by_key, stability");
+    }
+  }
+
+  void test_count_by_key() {
+    parray<uint64_t> ks(300000, [&] (size_type i) {
+      return hash64(i % 5000);
+    });
+    auto c = count_by_key(ks.cbegin(), ks.cend(), [&] (uint64_t k) {
+      return k;
+    });
+    std::map<uint64_t, size_type> ref;
+    for (size_type i = 0; i < ks.size(); i++) {
+      ref[ks[i]]++;
+    }
+    bool ok = c.size() == ref.size();
+    size_type j = 0;
+    for (auto& kv : ref) {
+      ok = ok && c[j].first == kv.first && c[j].second == kv.second;
+      j++;
+    }
+    check(ok, "count_by_key");
+  }
+
+  // a poor hash, under which many distinct keys collide
+  struct colliding_hash {
+    size_t operator()(long x) const {
+      return x % 3;
+    }
+  };
+
+  using item_type = std::pair<long, long>;
+
+  // true if the items of each key are contiguous in ys, and in the
+  // order in which they appear in xs
+  bool is_semisorted(const parray<item_type>& xs, const parray<item_type>& ys) {
+    if (xs.size() != ys.size()) {
+      return false;
+    }
+    std::map<long, std::vector<long>> expected, found;
+    for (size_type i = 0; i < xs.size(); i++) {
+      expected[xs[i].first].push_back(xs[i].second);
+    }
+    for (size_type i = 0; i < ys.size(); i++) {
+      long k = ys[i].first;
+      if (i > 0 && k != ys[i - 1].first && found.count(k) > 0) {
+        return false;
+      }
+      found[k].push_back(ys[i].second);
+    }
+    return expected == found;
+  }
+
+  void test_semisort() {
+    auto key = [&] (const item_type& x) {
+      return x.first;
+    };
+    for (size_type n : { 0ul, 1ul, 5000ul, 100000ul }) {
+      for (size_type nb_keys : { 1ul, 2ul, 1000ul, 1000000000ul }) {
+        parray<item_type> xs(n, [&] (size_type i) {
+          return std::make_pair((long)(hash64(i) % nb_keys), (long)i);
+        });
+        check(is_semisorted(xs, semisort(xs.cbegin(), xs.cend(), key)), "semisort");
+        if (n <= 5000) {
+          check(is_semisorted(xs, semisort(xs.cbegin(), xs.cend(), key, colliding_hash())),
+                "semisort, colliding hashes");
+        }
+        parray<item_type> d = remove_duplicates(xs.cbegin(), xs.cend(), key);
+        std::map<long, long> first;
+        for (size_type i = 0; i < n; i++) {
+          first.insert(xs[i]);
+        }
+        bool ok = d.size() == first.size();
+        for (size_type i = 0; i < d.size() && ok; i++) {
+          ok = first[d[i].first] == d[i].second;
+        }
+        check(ok, "remove_duplicates");
+      }
+    }
+  }
+
+  void test_unique() {
+    parray<int> xs(100000, [&] (size_type i) {
+      return (int)(hash64(i) % 777);
+    });
+    parray<int> ys = remove_duplicates(xs.cbegin(), xs.cend());
+    check(ys.size() == 777, "remove_duplicates, default key");
+    sptl::sort(xs.begin(), xs.end(), std::less<int>());
+    parray<int> zs = sptl::unique(xs.cbegin(), xs.cend());
+    bool ok = zs.size() == 777;
+    for (size_type i = 0; i < zs.size() && ok; i++) {
+      ok = zs[i] == (int)i;
+    }
+    check(ok, "unique");
+    parray<int> empty;
+    check(sptl::unique(empty.cbegin(), empty.cend()).size() == 0, "unique, empty");
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_histogram_and_group_by_key();
+    sptl::test_count_by_key();
+    sptl::test_semisort();
+    sptl::test_unique();
+    r = sptl::report("group");
+  });
+  return r;
+}
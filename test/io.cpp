@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "spio.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  std::string temp_path(const char* name) {
+    const char* dir = getenv("TMPDIR");
+    return std::string((dir == nullptr) ? "/tmp" : dir) + "/sptl_test_" + name;
+  }
+  
+  void write_raw(const std::string& path, const void* p, size_type n) {
+    FILE* f = fopen(path.c_str(), "wb");
+    check(f != nullptr, "cannot create a temporary file");
+    if (f != nullptr) {
+      fwrite(p, 1, n, f);
+      fclose(f);
+    }
+  }
+  
+  void test_input() {
+    std::string text;
+    for (int i = 0; i < 300000; i++) {
+      text += (char)('a' + i % 26);
+    }
+    std::string path = temp_path("input.txt");
+    write_raw(path, text.data(), text.size());
+    for (bool prefault : { true, false }) {
+      pstring s = read_file(path, prefault);
+      check(std::string(s.c_str(), s.size()) == text, "read_file");
+    }
+    write_raw(path, "", 0);
+    check(read_file(path).size() == 0, "read_file, empty file");
+    std::vector<long> xs(100000);
+    for (size_type i = 0; i < xs.size(); i++) {
+      xs[i] = (long)(i * i);
+    }
+    write_raw(path, xs.data(), xs.size() * sizeof(long));
+    for (bool prefault : { true, false }) {
+      parray<long> ys = read_binary<long>(path, prefault);
+      check(std::equal(xs.begin(), xs.end(), ys.cbegin()) && ys.size() == xs.size(),
+            "read_binary");
+    }
+    mmap_view<long> view(path);
+    check(view.size() == xs.size() && view[999] == 999L * 999, "mmap_view");
+    mmap_view<long> view2(std::move(view));
+    check(view2.size() == xs.size() && view.size() == 0, "mmap_view, move");
+    remove(path.c_str());
+  }
+  
+  std::string read_all(const std::string& path) {
+    std::string result;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+      return result;
+    }
+    char buf[1 << 12];
+    size_type n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+      result.append(buf, n);
+    }
+    fclose(f);
+    return result;
+  }
+  
+  void test_output() {
+    std::string path = temp_path("output");
+    size_type n = 100000;
+    parray<long> xs(n, [&] (size_type i) {
+      return (long)i * 7919 - 300000;
+    });
+    xs[0] = std::numeric_limits<long>::min();
+    write_text(path, xs);
+    std::string text;
+    for (size_type i = 0; i < n; i++) {
+      text += std::to_string(xs[i]) + "\n";
+    }
+    check(read_all(path) == text, "write_text, parray");
+    pchunkedseq<int> ys(50000, [&] (size_type i) {
+      return (int)i;
+    });
+    write_text(path, ys, ",");
+    text.clear();
+    for (int i = 0; i < 50000; i++) {
+      text += std::to_string(i) + ",";
+    }
+    check(read_all(path) == text, "write_text, pchunkedseq");
+    parray<char> cs = { 'a', 'b', 'c' };
+    write_text(path, cs, "");
+    check(read_all(path) == "abc", "write_text, characters");
+    write_binary(path, xs);
+    parray<long> xs2 = read_binary<long>(path);
+    check(xs2.size() == n && std::equal(xs2.cbegin(), xs2.cend(), xs.cbegin()),
+          "write_binary, parray");
+    write_binary(path, ys);
+    parray<int> ys2 = read_binary<int>(path);
+    check(ys2.size() == ys.seq.size() && std::equal(ys2.cbegin(), ys2.cend(), ys.seq.cbegin()),
+          "write_binary, pchunkedseq");
+    pstring s(3000000, [&] (size_type i) {
+      return (char)('a' + i % 26);
+    });
+    write_file(path, s);
+    check(read_all(path) == std::string(s.c_str(), s.size()), "write_file");
+    remove(path.c_str());
+  }
+  
+  // writes to a pipe, which does not support positional writes; the
+  // output fits in the buffer of the pipe
+  void test_pipe() {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      check(false, "cannot create a pipe");
+      return;
+    }
+    pchunkedseq<int> xs(10000, [&] (size_type i) {
+      return (int)i;
+    });
+    write_binary("/dev/fd/" + std::to_string(fds[1]), xs);
+    close(fds[1]);
+    std::string bytes = read_all("/dev/fd/" + std::to_string(fds[0]));
+    close(fds[0]);
+    check(bytes.size() == 10000 * sizeof(int)
+          && std::equal(xs.seq.cbegin(), xs.seq.cend(), (const int*)bytes.data()),
+          "write_binary, pchunkedseq, to a pipe");
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_input();
+    sptl::test_output();
+    sptl::test_pipe();
+    r = sptl::report("io");
+  });
+  return r;
+}
@@ -0,0 +1,100 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "spparse.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  bool parse_int(const std::string& s, long& dst) {
+    return parse_int(s.data(), s.data() + s.size(), dst);
+  }
+  
+  bool parse_double(const std::string& s, double& dst) {
+    return parse_double(s.data(), s.data() + s.size(), dst);
+  }
+  
+  void test_parse_int() {
+    long x;
+    check(parse_int("123", x) && x == 123, "parse_int");
+    check(parse_int("-0", x) && x == 0, "parse_int, negative zero");
+    check(parse_int("9223372036854775807", x) && x == std::numeric_limits<long>::max(),
+          "parse_int, largest");
+    check(parse_int("-9223372036854775808", x) && x == std::numeric_limits<long>::min(),
+          "parse_int, smallest");
+    check(! parse_int("9223372036854775808", x), "parse_int, overflow");
+    check(! parse_int("-9223372036854775809", x), "parse_int, underflow");
+    for (const char* s : { "", "-", "+", "1a", "--1", "a" }) {
+      check(! parse_int(s, x), "parse_int, malformed");
+    }
+  }
+  
+  void test_parse_double() {
+    double d;
+    for (const char* s : { "", "-", ".", "1e", "1e+", "e5", "1.2.3", "abc", "1x" }) {
+      check(! parse_double(s, d), "parse_double, malformed");
+    }
+    // the results must be those of strtod, bit for bit
+    size_type nb_wrong = 0;
+    for (unsigned i = 0; i < 100000; i++) {
+      char buf[64];
+      unsigned r = hashu(i);
+      double u = hashd((int)i);
+      switch (i % 5) {
+        case 0:
+          snprintf(buf, sizeof(buf), "%.17g", (u - 0.5) * 2e6);
+          break;
+        case 1:
+          snprintf(buf, sizeof(buf), "%.6f", u);
+          break;
+        case 2:
+          snprintf(buf, sizeof(buf), "%ue%d", r % 100000, (int)(hashu(r) % 600) - 300);
+          break;
+        case 3:
+          snprintf(buf, sizeof(buf), "%.25e", u - 0.5);
+          break;
+        default:
+          snprintf(buf, sizeof(buf), "%u%u.%03u", r, hashu(r), r % 1000);
+      }
+      if ((! parse_double(buf, d)) || d != strtod(buf, nullptr)) {
+        nb_wrong++;
+      }
+    }
+    check(nb_wrong == 0, "parse_double, agreement with strtod");
+  }
+  
+  void test_parse_numbers() {
+    std::string text;
+    std::vector<long> ref;
+    for (unsigned i = 0; i < 100000; i++) {
+      long v = (long)(hashu(i) % 1000000) - 500000;
+      ref.push_back(v);
+      text += std::to_string(v) + ((i % 7 == 0) ? "\n" : " ");
+    }
+    text += " 12x 5";
+    parray<size_type> malformed;
+    parray<long> xs = parse_ints(pstring(text.c_str()), malformed);
+    check(xs.size() == ref.size() + 2 && std::equal(ref.begin(), ref.end(), xs.cbegin()),
+          "parse_ints");
+    check(malformed.size() == 1 && text.substr(malformed[0], 3) == "12x"
+          && xs[ref.size()] == 0 && xs[ref.size() + 1] == 5, "parse_ints, malformed token");
+    parray<double> ds = parse_doubles(pstring("1.5,2e3,,x,-0.25"), malformed, ",");
+    check(ds.size() == 4 && ds[0] == 1.5 && ds[1] == 2000.0 && ds[3] == -0.25
+          && malformed.size() == 1 && malformed[0] == 9, "parse_doubles");
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_parse_int();
+    sptl::test_parse_double();
+    sptl::test_parse_numbers();
+    r = sptl::report("parse");
+  });
+  return r;
+}
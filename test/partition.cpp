@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "spdataparallel.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  using item_type = std::pair<int, int>;
+
+  void test_partition(size_type n, int nb_keys, int pivot) {
+    parray<item_type> xs(n, [&] (size_type i) {
+      return std::make_pair((int)(hash64(i * 7 + nb_keys) % nb_keys), (int)i);
+    });
+    auto less = [&] (const item_type& x) {
+      return x.first < pivot;
+    };
+    auto eq = [&] (const item_type& x) {
+      return x.first == pivot;
+    };
+    std::vector<item_type> ref(xs.cbegin(), xs.cend());
+    size_type nb_less = std::stable_partition(ref.begin(), ref.end(), less) - ref.begin();
+    size_type nb_not_greater = std::stable_partition(ref.begin() + nb_less, ref.end(), eq) - ref.begin();
+    std::vector<item_type> sorted(xs.cbegin(), xs.cend());
+    std::sort(sorted.begin(), sorted.end());
+    auto is_permutation = [&] (const parray<item_type>& ys) {
+      std::vector<item_type> zs(ys.cbegin(), ys.cend());
+      std::sort(zs.begin(), zs.end());
+      return zs == sorted;
+    };
+    auto is_partitioned3 = [&] (const parray<item_type>& ys, std::pair<size_type, size_type> p) {
+      bool ok = p.first == nb_less && p.second == nb_not_greater;
+      for (size_type i = 0; i < n && ok; i++) {
+        ok = (i < p.first) ? less(ys[i]) : ((i < p.second) ? eq(ys[i]) : ! less(ys[i]) && ! eq(ys[i]));
+      }
+      return ok;
+    };
+    // out of place: stable
+    parray<item_type> dst;
+    dst.reset(n);
+    size_type k = dps::partition(xs.cbegin(), xs.cend(), dst.begin(), less);
+    std::vector<item_type> stable_ref(xs.cbegin(), xs.cend());
+    std::stable_partition(stable_ref.begin(), stable_ref.end(), less);
+    check(k == nb_less && std::equal(dst.cbegin(), dst.cend(), stable_ref.begin()),
+          "dps::partition");
+    auto p = dps::partition3(xs.cbegin(), xs.cend(), dst.begin(), less, eq);
+    check(p.first == nb_less && p.second == nb_not_greater
+          && std::equal(dst.cbegin(), dst.cend(), ref.begin()), "dps::partition3");
+    // in place: a permutation, split at the same positions
+    parray<item_type> ys(xs);
+    k = sptl::partition(ys.begin(), ys.end(), less);
+    bool ok = k == nb_less;
+    for (size_type i = 0; i < n && ok; i++) {
+      ok = less(ys[i]) == (i < k);
+    }
+    check(ok && is_permutation(ys), "partition");
+    parray<item_type> zs(xs);
+    p = sptl::partition3(zs.begin(), zs.end(), less, eq);
+    check(is_partitioned3(zs, p) && is_permutation(zs), "partition3");
+  }
+
+  void test() {
+    // sizes on both sides of the block size, and pivots that send every
+    // item to one side
+    for (size_type n : { 0ul, 1ul, 2ul, 2047ul, 2048ul, 2049ul, 10000ul, 100003ul }) {
+      for (int nb_keys : { 1, 2, 3, 10, 1000 }) {
+        for (int pivot : { 0, 1, nb_keys / 2, nb_keys }) {
+          test_partition(n, nb_keys, pivot);
+        }
+      }
+    }
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("partition");
+  });
+  return r;
+}
@@ -0,0 +1,58 @@
+#include <map>
+
+#include "cmdline.hpp"
+#include "sppaugmap.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  using entry_type = std::pair<int, long>;
+  
+  void test(int n) {
+    parray<entry_type> kv(n, [&] (size_type i) {
+      return std::make_pair(2 * (int)i, (long)(hashu((unsigned)i + 5) % 100));
+    });
+    paugmented_map<int, long> ms(kv.cbegin(), kv.cend());
+    paugmented_map<int, long, aug_count<int, long>> mc(kv.cbegin(), kv.cend());
+    paugmented_map<int, long, aug_max<int, long>> mx(kv.cbegin(), kv.cend());
+    std::map<int, long> e(kv.cbegin(), kv.cend());
+    check(ms.size() == e.size(), "size");
+    for (int q = 0; q < 200; q++) {
+      int lo = (int)(hashu(q) % (2 * n + 3)) - 1;
+      int hi = (int)(hashu(q + 999) % (2 * n + 3)) - 1;
+      long sum = 0;
+      long count = 0;
+      long max = std::numeric_limits<long>::lowest();
+      for (auto it = e.lower_bound(lo); it != e.end() && it->first < hi; it++) {
+        sum += it->second;
+        count++;
+        max = std::max(max, it->second);
+      }
+      check(ms.aug_range(lo, hi) == sum, "aug_sum");
+      check(mc.aug_range(lo, hi) == count, "aug_count");
+      check(mx.aug_range(lo, hi) == max, "aug_max");
+    }
+    check(ms.size() == e.size(), "aug_range leaves the map unchanged");
+    ms.insert(std::make_pair(-10, 1000L));
+    check(ms.aug_range(-10, -9) == 1000, "aug_range after insert");
+    ms.erase(-10);
+    check(ms.aug_range(-100, -9) == 0, "aug_range after erase");
+  }
+  
+  void test() {
+    for (int n : { 0, 1, 50, 20000 }) {
+      test(n);
+    }
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("paugmap");
+  });
+  return r;
+}
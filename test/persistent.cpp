@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "sppersistentmap.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  template <class Set>
+  std::vector<int> items_of(const Set& s) {
+    parray<int> xs = s.elements();
+    return std::vector<int>(xs.cbegin(), xs.cend());
+  }
+
+  void test_set(int n, int m) {
+    int nb_keys = 2 * n + 10;
+    parray<int> xs(n, [&] (size_type i) {
+      return (int)(hash64(i) % nb_keys);
+    });
+    parray<int> ys(m, [&] (size_type i) {
+      return (int)(hash64(i + 7) % nb_keys);
+    });
+    persistent_pset<int> s(xs.cbegin(), xs.cend());
+    persistent_pset<int> t(ys.cbegin(), ys.cend());
+    std::set<int> es(xs.cbegin(), xs.cend());
+    std::set<int> et(ys.cbegin(), ys.cend());
+    std::vector<int> vs(es.begin(), es.end());
+    std::vector<int> vt(et.begin(), et.end());
+    check(items_of(s) == vs && s.size() == es.size(), "persistent_pset, construction");
+    std::vector<int> u, i, d;
+    std::set_union(es.begin(), es.end(), et.begin(), et.end(), std::back_inserter(u));
+    std::set_intersection(es.begin(), es.end(), et.begin(), et.end(), std::back_inserter(i));
+    std::set_difference(es.begin(), es.end(), et.begin(), et.end(), std::back_inserter(d));
+    persistent_pset<int> snapshot = s.snapshot();
+    persistent_pset<int> s1 = s;
+    persistent_pset<int> s2 = s;
+    persistent_pset<int> s3 = s;
+    s1.merge(t);
+    s2.intersect(t);
+    s3.diff(t);
+    check(items_of(s1) == u && s1.size() == u.size(), "persistent_pset::merge");
+    check(items_of(s2) == i && s2.size() == i.size(), "persistent_pset::intersect");
+    check(items_of(s3) == d && s3.size() == d.size(), "persistent_pset::diff");
+    // the inputs and the snapshot are left unchanged
+    check(items_of(s) == vs && items_of(snapshot) == vs && items_of(t) == vt,
+          "persistent_pset, inputs after bulk operations");
+    for (int k = 0; k < 100; k++) {
+      int x = (int)(hash64(k + 3) % nb_keys);
+      check(s.insert(x) == es.insert(x).second, "persistent_pset::insert");
+      int y = (int)(hash64(k + 33) % nb_keys);
+      check(s.erase(y) == es.erase(y), "persistent_pset::erase");
+    }
+    check(items_of(s) == std::vector<int>(es.begin(), es.end()) && items_of(snapshot) == vs,
+          "persistent_pset, snapshot after updates");
+    s.insert_batch(ys.cbegin(), ys.cend());
+    es.insert(ys.cbegin(), ys.cend());
+    check(items_of(s) == std::vector<int>(es.begin(), es.end()), "persistent_pset::insert_batch");
+    size_type nb = es.size();
+    for (int x : xs) {
+      es.erase(x);
+    }
+    check(s.erase_batch(xs.cbegin(), xs.cend()) == nb - es.size()
+          && items_of(s) == std::vector<int>(es.begin(), es.end()), "persistent_pset::erase_batch");
+    bool ok = true;
+    for (int x : es) {
+      ok = ok && s.find(x) != nullptr && *s.find(x) == x && s.count(x) == 1;
+    }
+    for (int x : xs) {
+      ok = ok && s.find(x) == nullptr;
+    }
+    check(ok, "persistent_pset::find");
+  }
+
+  void test_map() {
+    using map_type = persistent_pmap<int, int>;
+    map_type m = { { 1, 10 }, { 3, 30 }, { 5, 50 } };
+    map_type snapshot = m.snapshot();
+    m.insert_or_assign(std::make_pair(1, 11));
+    check(! m.insert(std::make_pair(3, 31)), "persistent_pmap::insert, present key");
+    check(m.find(1)->second == 11 && m.find(3)->second == 30 && snapshot.find(1)->second == 10,
+          "persistent_pmap::insert_or_assign");
+    // on keys present in both maps, the entries of the updated map are kept
+    map_type other = { { 3, 33 }, { 4, 44 } };
+    map_type u = m;
+    u.merge(other);
+    check(u.size() == 4 && u.find(3)->second == 30 && u.find(4)->second == 44,
+          "persistent_pmap::merge");
+    map_type i = m;
+    i.intersect(other);
+    check(i.size() == 1 && i.find(3)->second == 30, "persistent_pmap::intersect");
+    map_type d = m;
+    d.diff(other);
+    check(d.size() == 2 && d.count(3) == 0, "persistent_pmap::diff");
+    check(m.erase(5) == 1 && m.erase(5) == 0 && snapshot.count(5) == 1, "persistent_pmap::erase");
+    map_type moved(std::move(m));
+    check(moved.size() == 2 && m.empty(), "persistent_pmap, move");
+  }
+
+  void test() {
+    for (int n : { 0, 1, 100, 50000 }) {
+      for (int m : { 0, 1, 10, 3000, 60000 }) {
+        test_set(n, m);
+      }
+    }
+    test_map();
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("persistent");
+  });
+  return r;
+}
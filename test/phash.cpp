@@ -0,0 +1,95 @@
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cmdline.hpp"
+#include "spphashmap.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  template <class Set>
+  bool same_items(const Set& s, const std::unordered_set<int>& e) {
+    parray<int> xs = s.elements();
+    return s.size() == e.size() && std::unordered_set<int>(xs.cbegin(), xs.cend()) == e;
+  }
+  
+  void test_set(int n) {
+    parray<int> xs = gen_integ_parray<int>(n, 0, 1 + n / 2);
+    phash_set<int> s(xs.cbegin(), xs.cend());
+    std::unordered_set<int> e(xs.cbegin(), xs.cend());
+    check(same_items(s, e), "construction");
+    for (int x : e) {
+      check(s.find(x) != nullptr && *s.find(x) == x, "find");
+    }
+    check(s.find(-1) == nullptr, "find, absent key");
+    // concurrent insertion into a reserved table
+    phash_set<int> t;
+    t.reserve(n);
+    parallel_for((size_type)0, (size_type)n, [&] (size_type i) {
+      t.concurrent_insert(xs[i]);
+    });
+    check(same_items(t, e), "concurrent_insert");
+    // assignment
+    phash_set<int> u = { -1, -2, -3 };
+    u = t;
+    check(same_items(u, e) && same_items(t, e), "copy assignment");
+    u.insert(-4);
+    check(t.find(-4) == nullptr, "copy assignment makes a copy");
+    u = std::move(t);
+    check(same_items(u, e), "move assignment");
+    check(t.size() == 0 && t.find(0) == nullptr, "move assignment leaves an empty set");
+    t.insert(7);
+    check(t.size() == 1, "insert after move assignment");
+    u = u;
+    check(same_items(u, e), "self assignment");
+    // erase every other key
+    int k = 0;
+    for (int x : e) {
+      if (k++ % 2 == 1) {
+        check(s.erase(x) == 1, "erase");
+      }
+    }
+    k = 0;
+    for (int x : e) {
+      check((s.find(x) != nullptr) == (k++ % 2 == 0), "find after erase");
+    }
+  }
+  
+  void test_map() {
+    parray<std::pair<int, int>> kv(100000, [&] (size_type i) {
+      return std::make_pair((int)i, 2 * (int)i);
+    });
+    phash_map<int, int> m(kv.cbegin(), kv.cend());
+    phash_map<int, int> c;
+    c[5] = 1;
+    c = m;
+    bool ok = c.size() == kv.size();
+    for (auto& e : kv) {
+      ok = ok && c.find(e.first) != nullptr && c.find(e.first)->second == e.second;
+    }
+    check(ok, "map copy assignment");
+    phash_map<int, int> d;
+    d = std::move(c);
+    check(d.size() == kv.size() && c.size() == 0, "map move assignment");
+    d[3] += 1;
+    check(d[3] == 7 && m[3] == 6, "map operator[]");
+  }
+  
+  void test() {
+    for (int n : { 0, 1, 10, 1000, 100000 }) {
+      test_set(n);
+    }
+    test_map();
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("phash");
+  });
+  return r;
+}
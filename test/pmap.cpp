@@ -0,0 +1,50 @@
+#include "cmdline.hpp"
+#include "sppmap.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  using map_type = pmap<int, long>;
+  
+  void test() {
+    for (int n : { 0, 1, 50, 20000 }) {
+      map_type m(n, [&] (size_type i) {
+        return std::make_pair(3 * (int)i, (long)i);
+      });
+      // range: the result is a map that supports further updates
+      map_type r = m.range(30, 60);
+      check(r.size() == (size_type)std::max(0, std::min(n, 20) - 10), "range size");
+      check(m.size() == (size_type)n, "range leaves the map unchanged");
+      if (n >= 20) {
+        check(r.find(33) != r.cend(), "find after range");
+        check(r.find(60) == r.cend(), "range excludes hi");
+      }
+      r.insert(std::make_pair(1, 1L));
+      r[2] = 2;
+      check(r.find(1) != r.cend() && r[2] == 2, "insert after range");
+      // filter: same, on the entries of odd value
+      map_type f = m.filter([&] (const std::pair<int, long>& e) {
+        return e.second % 2 == 1;
+      });
+      check(f.size() == (size_type)n / 2, "filter size");
+      f.insert(std::make_pair(-1, 0L));
+      f[-2] = 5;
+      check(f.find(-1) != f.cend() && f[-2] == 5, "insert after filter");
+      // a moved-from map is empty and usable
+      map_type g(std::move(f));
+      check(f.size() == 0 && f.find(-1) == f.cend(), "moved-from map");
+      f.insert(std::make_pair(7, 7L));
+      check(f.size() == 1 && g.find(-2) != g.cend(), "insert after move");
+    }
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("pmap");
+  });
+  return r;
+}
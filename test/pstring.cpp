@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "sppstring.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  std::string to_std(const pstring& s) {
+    return std::string(s.c_str(), s.size());
+  }
+  
+  void test_rope() {
+    std::string ref;
+    pstring s;
+    for (int i = 0; i < 3000; i++) {
+      std::string piece(1 + i % 7, (char)('a' + i % 26));
+      ref += piece;
+      s += pstring(piece.c_str());
+    }
+    check(s.is_rope() && s.size() == ref.size(), "append makes a rope");
+    check(to_std(s) == ref, "c_str of a rope");
+    check(s.is_rope(), "const access keeps the rope");
+    check(to_std(s.substr(100, 4000)) == ref.substr(100, 4000), "substr of a rope");
+    check(to_std(s.substr(ref.size(), 10)) == "", "empty substr of a rope");
+    // a write through the indexing operator is seen by later const reads
+    s[5] = '#';
+    ref[5] = '#';
+    check(to_std(s) == ref, "write after const access");
+    pstring tail;
+    s.split(7000, tail);
+    check(to_std(s) == ref.substr(0, 7000), "split");
+    check(to_std(tail) == ref.substr(7000), "split, tail");
+    s.concat(tail);
+    check(to_std(s) == ref && tail.size() == 0, "concat");
+    pstring c(s);
+    check(to_std(c) == ref, "copy of a rope");
+    s.flatten();
+    check((! s.is_rope()) && to_std(s) == ref, "flatten");
+  }
+  
+  void test_self_append() {
+    pstring s("hello");
+    s += s;
+    check(s.size() == 10 && to_std(s) == "hellohello", "self append, flat");
+    std::string ref;
+    pstring r;
+    for (int i = 0; i < 1000; i++) {
+      std::string piece(1 + i % 3, (char)('a' + i % 26));
+      ref += piece;
+      r += pstring(piece.c_str());
+    }
+    r += r;
+    check(to_std(r) == ref + ref, "self append, rope");
+  }
+
+  // const methods of the same rope, called in parallel
+  void test_concurrent_reads() {
+    std::string ref;
+    pstring s;
+    for (int i = 0; i < 20000; i++) {
+      std::string piece(1 + i % 5, (char)('a' + i % 26));
+      ref += piece;
+      s += pstring(piece.c_str());
+    }
+    const pstring& cs = s;
+    size_type nb_z = std::count(ref.begin(), ref.end(), 'z');
+    parray<int> ok(64, 0);
+    parallel_for((size_type)0, ok.size(), [&] (size_type lo, size_type hi) {
+      return (hi - lo) * ref.size();
+    }, [&] (size_type i) {
+      switch (i % 4) {
+        case 0:
+          ok[i] = to_std(cs) == ref;
+          break;
+        case 1:
+          ok[i] = cs.count('z') == nb_z;
+          break;
+        case 2:
+          ok[i] = cs.find('q', i) == ref.find('q', i);
+          break;
+        default:
+          ok[i] = cs.split("aeiou").size() > 0;
+      }
+    });
+    check(std::count(ok.cbegin(), ok.cend(), 0) == 0, "concurrent const reads");
+    check(s.is_rope(), "concurrent const reads keep the rope");
+  }
+
+  // the tokens of ref, split at any of the characters of delims
+  std::vector<std::string> tokens_of(const std::string& ref, const char* delims) {
+    std::vector<std::string> tokens;
+    size_type lo = ref.find_first_not_of(delims);
+    while (lo != std::string::npos) {
+      size_type hi = ref.find_first_of(delims, lo);
+      hi = (hi == std::string::npos) ? ref.size() : hi;
+      tokens.push_back(ref.substr(lo, hi - lo));
+      lo = ref.find_first_not_of(delims, hi);
+    }
+    return tokens;
+  }
+
+  void test_search() {
+    // matches at the ends, across block boundaries and nowhere
+    for (size_type n : { 0ul, 1ul, 100ul, 4095ul, 4096ul, 4097ul, 100000ul }) {
+      pstring s(n, [&] (size_type i) {
+        return " ab,\n\tcd;  "[hash64(i) % 11];
+      });
+      std::string ref = to_std(s);
+      const char* delims = " ,;\n\t";
+      for (char c : { 'a', ';', '\t', 'z' }) {
+        for (size_type pos : { 0ul, 1ul, n / 2, n }) {
+          check(s.find(c, pos) == (size_type)ref.find(c, pos), "find char");
+        }
+        check(s.count(c) == (size_type)std::count(ref.begin(), ref.end(), c), "count");
+      }
+      for (const char* t : { "", "a", "cd;", "b,\n\tc", "zz" }) {
+        for (size_type pos : { 0ul, 3ul, n / 2 }) {
+          check(s.find(pstring(t), pos) == (size_type)ref.find(t, pos), "find string");
+        }
+      }
+      auto is_letter = [&] (char c) {
+        return c >= 'a' && c <= 'z';
+      };
+      check(s.count_if(is_letter) == (size_type)std::count_if(ref.begin(), ref.end(), is_letter),
+            "count_if");
+      parray<pstring::token_type> tokens = s.split(delims);
+      std::vector<std::string> ref_tokens = tokens_of(ref, delims);
+      bool ok = tokens.size() == ref_tokens.size();
+      for (size_type i = 0; i < tokens.size() && ok; i++) {
+        ok = ref.substr(tokens[i].first, tokens[i].second) == ref_tokens[i];
+      }
+      check(ok, "split");
+    }
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_rope();
+    sptl::test_self_append();
+    sptl::test_concurrent_reads();
+    sptl::test_search();
+    r = sptl::report("pstring");
+  });
+  return r;
+}
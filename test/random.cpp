@@ -0,0 +1,77 @@
+#include <cmath>
+
+#include "cmdline.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  using block_type = philox4x32::block_type;
+  
+  // the known-answer tests of the Random123 distribution for Philox4x32-10
+  void test_philox() {
+    check(philox4x32(0)(block_type{{ 0, 0, 0, 0 }})
+          == block_type{{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }}, "philox, zeros");
+    check(philox4x32(0xffffffffffffffffull)(block_type{{ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }})
+          == block_type{{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }}, "philox, ones");
+    philox4x32 g(((uint64_t)0x299f31d0 << 32) | 0xa4093822);
+    check(g(block_type{{ 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }})
+          == block_type{{ 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }}, "philox, pi");
+    // the batched generator agrees with the block function
+    std::vector<uint32_t> words(4 * 1003);
+    g.generate(5, 1003, words.data());
+    bool same = true;
+    for (size_type i = 0; i < 1003; i++) {
+      block_type b = g((uint64_t)(5 + i));
+      same = same && std::equal(b.begin(), b.end(), words.begin() + 4 * i);
+    }
+    check(same, "philox, generate");
+  }
+  
+  template <class Array>
+  std::pair<double, double> mean_and_variance(const Array& xs) {
+    double s = 0.0;
+    double s2 = 0.0;
+    for (size_type i = 0; i < xs.size(); i++) {
+      s += xs[i];
+      s2 += xs[i] * xs[i];
+    }
+    double mean = s / xs.size();
+    return std::make_pair(mean, s2 / xs.size() - mean * mean);
+  }
+  
+  void test_arrays() {
+    size_type n = 1000001;
+    parray<double> u = random_uniform(n, 42);
+    parray<double> u2 = random_uniform(n, 42);
+    check(std::equal(u.cbegin(), u.cend(), u2.cbegin()), "random_uniform is deterministic");
+    check(std::count_if(u.cbegin(), u.cend(), [&] (double x) {
+      return x < 0.0 || x >= 1.0;
+    }) == 0, "random_uniform, range");
+    auto mv = mean_and_variance(u);
+    check(std::abs(mv.first - 0.5) < 0.01 && std::abs(mv.second - 1.0 / 12) < 0.01,
+          "random_uniform, moments");
+    mv = mean_and_variance(random_normal(n, 7, 1.0, 2.0));
+    check(std::abs(mv.first - 1.0) < 0.02 && std::abs(mv.second - 4.0) < 0.05,
+          "random_normal, moments");
+    mv = mean_and_variance(random_exponential(n, 9, 2.0));
+    check(std::abs(mv.first - 0.5) < 0.01, "random_exponential, mean");
+    parray<int> is = random_integers<int>(n, 3, -5, 5);
+    check(*std::min_element(is.cbegin(), is.cend()) == -5
+          && *std::max_element(is.cbegin(), is.cend()) == 4, "random_integers, range");
+    parray<uint64_t> bs = random_bits(n, 1);
+    parray<uint64_t> bs2 = random_bits(n, 2);
+    check(! std::equal(bs.cbegin(), bs.cend(), bs2.cbegin()), "random_bits, seeds");
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_philox();
+    sptl::test_arrays();
+    r = sptl::report("random");
+  });
+  return r;
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "cmdline.hpp"
+#include "spserialize.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  std::string temp_path(const char* name) {
+    const char* dir = getenv("TMPDIR");
+    return std::string((dir == nullptr) ? "/tmp" : dir) + "/sptl_test_" + name;
+  }
+
+  void test_parray() {
+    std::string path = temp_path("parray.bin");
+    // sizes on both sides of the block size
+    for (size_type n : { 0ul, 1ul, 1000ul, 300000ul }) {
+      parray<long> xs(n, [&] (size_type i) {
+        return (long)(i * i);
+      });
+      serialize(path, xs);
+      parray<long> ys(3);
+      deserialize(path, ys);
+      check(ys.size() == n && std::equal(xs.cbegin(), xs.cend(), ys.cbegin()), "parray");
+    }
+    // pairs are encoded field by field
+    parray<std::pair<int, double>> ps(1000, [&] (size_type i) {
+      return std::make_pair((int)i, i * 0.5);
+    });
+    serialize(path, ps);
+    parray<std::pair<int, double>> qs;
+    deserialize(path, qs);
+    check(qs.size() == ps.size() && std::equal(ps.cbegin(), ps.cend(), qs.cbegin()),
+          "parray of pairs");
+    remove(path.c_str());
+  }
+
+  void test_pchunkedseq() {
+    std::string path = temp_path("pchunkedseq.bin");
+    pchunkedseq<int> xs(100000, [&] (size_type i) {
+      return (int)i * 3;
+    });
+    serialize(path, xs);
+    pchunkedseq<int> ys(5, [&] (size_type i) {
+      return 1;
+    });
+    deserialize(path, ys);
+    check(ys.seq.size() == xs.seq.size() && std::equal(xs.cbegin(), xs.cend(), ys.cbegin()),
+          "pchunkedseq");
+    remove(path.c_str());
+  }
+
+  void test_pset_and_pmap() {
+    std::string path = temp_path("pset.bin");
+    parray<int> keys(50000, [&] (size_type i) {
+      return (int)((i * 7919) % 100003);
+    });
+    pset<int> s(keys.cbegin(), keys.cend());
+    serialize(path, s);
+    pset<int> s2;
+    deserialize(path, s2);
+    check(s2.size() == s.size() && std::equal(s.cbegin(), s.cend(), s2.cbegin()), "pset");
+    // the loaded set supports lookups and updates
+    check(s2.find(keys[17]) != s2.cend() && s2.find(100004) == s2.cend(), "pset, find");
+    s2.insert(100004);
+    check(s2.size() == s.size() + 1, "pset, insert");
+    pmap<int, double> m;
+    for (int i = 0; i < 1000; i++) {
+      m.insert(std::make_pair(2 * i, i * 1.5));
+    }
+    serialize(path, m);
+    pmap<int, double> m2;
+    deserialize(path, m2);
+    check(m2.size() == 1000 && m2.find(20) != m2.cend() && m2.find(20)->second == 15.0
+          && m2.find(21) == m2.cend(), "pmap");
+    m2[21] = 1.0;
+    check(m2.size() == 1001, "pmap, insert");
+    remove(path.c_str());
+  }
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test_parray();
+    sptl::test_pchunkedseq();
+    sptl::test_pset_and_pmap();
+    r = sptl::report("serialize");
+  });
+  return r;
+}
@@ -0,0 +1,85 @@
+#include <map>
+
+#include "cmdline.hpp"
+#include "sppmap.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  using map_type = pmap<int, long>;
+  
+  // the keys of a map of size n are the multiples of step below
+  // step * n; the value of each entry tells which map it comes from
+  map_type make(size_type n, int step, long tag) {
+    return map_type(n, [&] (size_type i) {
+      int k = step * (int)i;
+      return std::make_pair(k, 10L * k + tag);
+    });
+  }
+  
+  template <class Map>
+  std::map<int, long> to_std(const Map& m) {
+    return std::map<int, long>(m.cbegin(), m.cend());
+  }
+  
+  void test(size_type n, size_type m, int step) {
+    std::map<int, long> xs = to_std(make(n, 2, 1));
+    std::map<int, long> ys = to_std(make(m, step, 2));
+    std::map<int, long> u = xs;
+    std::map<int, long> i;
+    std::map<int, long> d;
+    for (auto& e : ys) {
+      u.insert(e);
+    }
+    for (auto& e : xs) {
+      if (ys.count(e.first) == 0) {
+        d.insert(e);
+      } else {
+        i.insert(e);
+      }
+    }
+    {
+      map_type a = make(n, 2, 1);
+      map_type b = make(m, step, 2);
+      a.merge(b);
+      check(to_std(a) == u, "union keeps the values of the target");
+      check(b.size() == 0, "union empties its argument");
+    }
+    {
+      map_type a = make(n, 2, 1);
+      map_type b = make(m, step, 2);
+      a.intersect(b);
+      check(to_std(a) == i, "intersection keeps the values of the target");
+    }
+    {
+      map_type a = make(n, 2, 1);
+      map_type b = make(m, step, 2);
+      a.diff(b);
+      check(to_std(a) == d, "difference");
+    }
+  }
+  
+  void test() {
+    // sizes that exercise the recursive merge, with either input the
+    // larger one, and the special cases for a much smaller input
+    size_type sizes[][2] = { { 0, 0 }, { 1, 1 }, { 1, 0 }, { 0, 1 },
+                             { 100, 100 }, { 100, 150 }, { 150, 100 },
+                             { 3000, 5000 }, { 5000, 3000 },
+                             { 200000, 300000 }, { 300000, 200000 },
+                             { 10, 100000 }, { 100000, 10 } };
+    for (auto& s : sizes) {
+      test(s[0], s[1], 2);
+      test(s[0], s[1], 3);
+    }
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("setops");
+  });
+  return r;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <vector>
+
+#include "cmdline.hpp"
+#include "spsort.hpp"
+#include "sprandgen.hpp"
+#include "check.hpp"
+
+namespace sptl {
+
+  using pair_type = std::pair<unsigned, int>;
+  
+  template <class Key_fn>
+  void test_radix_sort(size_type n, const Key_fn& key_fn, int bits) {
+    parray<pair_type> xs(n, [&] (size_type i) {
+      return pair_type(hashu((unsigned)i), (int)i);
+    });
+    std::vector<pair_type> ys(xs.cbegin(), xs.cend());
+    std::stable_sort(ys.begin(), ys.end(), [&] (const pair_type& x, const pair_type& y) {
+      return key_fn(x) < key_fn(y);
+    });
+    radix_sort(xs.begin(), xs.end(), key_fn, bits);
+    check(std::equal(ys.begin(), ys.end(), xs.cbegin()), "radix_sort");
+  }
+  
+  bool is_permutation(const parray<size_type>& p) {
+    size_type n = p.size();
+    std::vector<char> seen(n, 0);
+    for (size_type i = 0; i < n; i++) {
+      if (p[i] >= n || seen[p[i]]) {
+        return false;
+      }
+      seen[p[i]] = 1;
+    }
+    return true;
+  }
+  
+  void test_shuffle() {
+    for (size_type n : { 0, 1, 2, 1000, 16385, 100000 }) {
+      parray<size_type> p = random_permutation(n, 12345);
+      check(is_permutation(p), "random_permutation");
+      parray<size_type> q = random_permutation(n, 12345);
+      check(std::equal(p.cbegin(), p.cend(), q.cbegin()), "random_permutation is deterministic");
+      parray<size_type> xs(n, [&] (size_type i) {
+        return i;
+      });
+      sptl::shuffle(xs.begin(), xs.end(), 7);
+      check(is_permutation(xs), "shuffle");
+    }
+    // each of the 6 permutations of 3 items shows up about as often
+    size_type counts[6] = { 0 };
+    for (int s = 0; s < 6000; s++) {
+      parray<size_type> p = random_permutation(3, s);
+      counts[2 * p[0] + (p[1] > p[2])]++;
+    }
+    check(*std::min_element(counts, counts + 6) > 850
+          && *std::max_element(counts, counts + 6) < 1150, "random_permutation, uniformity");
+  }
+  
+  // items with many equal keys, so that stability is observable
+  parray<pair_type> few_keys(size_type n) {
+    return parray<pair_type>(n, [&] (size_type i) {
+      return pair_type(hashu((unsigned)i) % 100, (int)i);
+    });
+  }
+
+  void test_comparison_sorts(size_type n) {
+    auto by_key = [] (const pair_type& x, const pair_type& y) {
+      return x.first < y.first;
+    };
+    parray<pair_type> xs = few_keys(n);
+    std::vector<pair_type> ref(xs.cbegin(), xs.cend());
+    std::stable_sort(ref.begin(), ref.end(), by_key);
+    parray<pair_type> ys(xs);
+    sptl::stable_sort(ys.begin(), ys.end(), by_key);
+    check(std::equal(ref.begin(), ref.end(), ys.cbegin()), "stable_sort");
+    parray<pair_type> zs(xs);
+    sptl::sort(zs.begin(), zs.end(), std::less<pair_type>());
+    std::vector<pair_type> sorted(xs.cbegin(), xs.cend());
+    std::sort(sorted.begin(), sorted.end());
+    check(std::equal(sorted.begin(), sorted.end(), zs.cbegin()), "sort");
+    parray<pair_type> ss(xs);
+    sample_sort(ss.begin(), ss.end(), std::less<pair_type>());
+    check(std::equal(sorted.begin(), sorted.end(), ss.cbegin()), "sample_sort");
+    for (size_type k : { (size_type)0, n / 3, (n == 0) ? 0 : n - 1 }) {
+      if (k >= n) {
+        continue;
+      }
+      parray<pair_type> us(xs);
+      sptl::nth_element(us.begin(), us.begin() + k, us.end(), std::less<pair_type>());
+      bool ok = us[k] == sorted[k];
+      for (size_type i = 0; i < n && ok; i++) {
+        ok = (i < k) ? ! (us[k] < us[i]) : ! (us[i] < us[k]);
+      }
+      check(ok, "nth_element");
+      parray<pair_type> vs(xs);
+      sptl::partial_sort(vs.begin(), vs.begin() + k, vs.end(), std::less<pair_type>());
+      check(std::equal(sorted.begin(), sorted.begin() + k, vs.cbegin()), "partial_sort");
+      parray<pair_type> ts = top_k(xs.cbegin(), xs.cend(), k, std::less<pair_type>());
+      check(ts.size() == k && std::equal(sorted.begin(), sorted.begin() + k, ts.cbegin()),
+            "top_k");
+    }
+    check(top_k(xs.cbegin(), xs.cend(), n + 5, std::less<pair_type>()).size() == n,
+          "top_k, k beyond n");
+  }
+
+  // true if the items of cs are those of ref, in increasing order of key
+  bool sorted_by_key(const pchunkedseq<pair_type>& cs, std::vector<pair_type> ref) {
+    std::vector<pair_type> xs(cs.cbegin(), cs.cend());
+    bool ok = std::is_sorted(xs.begin(), xs.end(), [] (const pair_type& x, const pair_type& y) {
+      return x.first < y.first;
+    });
+    std::sort(xs.begin(), xs.end());
+    std::sort(ref.begin(), ref.end());
+    return ok && xs == ref;
+  }
+
+  void test_pchunked_sort(size_type n, size_type m) {
+    auto by_key = [] (const pair_type& x, const pair_type& y) {
+      return x.first < y.first;
+    };
+    parray<pair_type> xs = few_keys(n + m);
+    std::vector<pair_type> ref1(xs.cbegin(), xs.cbegin() + n);
+    std::vector<pair_type> ref2(xs.cbegin() + n, xs.cend());
+    pchunkedseq<pair_type> cs(n, [&] (size_type i) {
+      return xs[i];
+    });
+    pchunkedseq<pair_type> ds(m, [&] (size_type i) {
+      return xs[n + i];
+    });
+    pchunkedseq<pair_type> cs2 = pchunked::sort(cs, by_key);
+    pchunkedseq<pair_type> ds2 = pchunked::sort(ds, by_key);
+    check(sorted_by_key(cs2, ref1) && sorted_by_key(ds2, ref2), "pchunked::sort");
+    pchunkedseq<pair_type> es = pchunked::merge(cs2, ds2, by_key);
+    check(sorted_by_key(es, std::vector<pair_type>(xs.cbegin(), xs.cend())), "pchunked::merge");
+  }
+
+  void test() {
+    test_shuffle();
+    for (size_type n : { 0, 1, 5, 1000, 100000 }) {
+      test_comparison_sorts(n);
+    }
+    for (size_type n : { 0, 1, 600, 50000 }) {
+      for (size_type m : { 0, 1, 3000, 70000 }) {
+        test_pchunked_sort(n, m);
+      }
+    }
+    for (size_type n : { 0, 1, 5, 1000, 100000 }) {
+      auto key32 = [] (const pair_type& x) {
+        return x.first;
+      };
+      auto key10 = [] (const pair_type& x) {
+        return x.first % 1024;
+      };
+      auto key8 = [] (const pair_type& x) {
+        return (uint8_t)x.first;
+      };
+      test_radix_sort(n, key32, 32);
+      test_radix_sort(n, key10, 10);
+      // more bits than the keys have
+      test_radix_sort(n, key32, 64);
+      test_radix_sort(n, key8, 100);
+      parray<unsigned> zs(n, [&] (size_type i) {
+        return hashu((unsigned)i);
+      });
+      std::vector<unsigned> ws(zs.cbegin(), zs.cend());
+      std::sort(ws.begin(), ws.end());
+      radix_sort(zs.begin(), zs.end(), [] (unsigned x) {
+        return x;
+      });
+      check(std::equal(ws.begin(), ws.end(), zs.cbegin()), "radix_sort, full width");
+    }
+  }
+  
+} // end namespace
+
+int main(int argc, char** argv) {
+  int r = 0;
+  sptl::launch(argc, argv, [&] {
+    sptl::test();
+    r = sptl::report("sort");
+  });
+  return r;
+}